@@ -0,0 +1,48 @@
+/*
+ * BL_AES.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+#ifndef INC_BL_AES_H_
+#define INC_BL_AES_H_
+
+
+/************************ Include ************************/
+#include <stdint.h>
+#include <string.h>
+#include "main.h"
+
+
+
+/************************ Defines ************************/
+
+#define BL_AES_BLOCK_SIZE						16
+#define BL_AES_KEY_SIZE							16
+#define BL_AES_ROUNDS							10
+/* One host frame worth of keystream plus a block for a misaligned start */
+#define BL_AES_KEYSTREAM_SIZE					(256+BL_AES_BLOCK_SIZE)
+
+
+/***************** DataType Deceleration *****************/
+
+typedef struct
+{
+	uint32_t Round_Key[4*(BL_AES_ROUNDS+1)] ;
+	/* Initial counter block , big endian 128 bit number */
+	uint32_t Nonce[4] ;
+	/* Keystream generated ahead for [Keystream_Offset , Keystream_Offset+Keystream_Length) */
+	uint8_t  Keystream[BL_AES_KEYSTREAM_SIZE] ;
+	uint32_t Keystream_Offset ;
+	uint32_t Keystream_Length ;
+}BL_AES_Context_t ;
+
+/******************** SW Implementation *******************/
+
+void BL_AES_Init (BL_AES_Context_t *Context , const uint8_t *Key , const uint8_t *Nonce) ;
+void BL_AES_Encrypt_Block (const BL_AES_Context_t *Context , const uint32_t *Input , uint32_t *Output) ;
+void BL_AES_CTR_Prepare (BL_AES_Context_t *Context , uint32_t Offset , uint32_t Length) ;
+void BL_AES_CTR_Crypt (BL_AES_Context_t *Context , uint32_t Offset , uint8_t *Data , uint32_t Length) ;
+
+#endif /* INC_BL_AES_H_ */
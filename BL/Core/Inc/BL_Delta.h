@@ -0,0 +1,58 @@
+/*
+ * BL_Delta.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+#ifndef INC_BL_DELTA_H_
+#define INC_BL_DELTA_H_
+
+
+/************************ Include ************************/
+#include <stdint.h>
+#include "main.h"
+
+
+
+/************************ Defines ************************/
+
+/*
+ * Patch format , fields little endian :
+ *   0x01 COPY   : Source_Offset(4) Length(4)             new = old[Source_Offset ...]
+ *   0x02 ADD    : Source_Offset(4) Length(4) Diff[Length] new = old[Source_Offset ...] + Diff
+ *   0x03 INSERT : Length(4) Data[Length]                 new = Data
+ * Instructions may be split over frames at any byte.
+ */
+#define BL_DELTA_OP_COPY						0x01
+#define BL_DELTA_OP_ADD							0x02
+#define BL_DELTA_OP_INSERT						0x03
+
+#define DELTA_APPLY_OK							1
+#define DELTA_APPLY_FAIL						0
+
+
+/***************** DataType Deceleration *****************/
+
+/* Receives every rebuilt byte , returns DELTA_APPLY_OK to continue */
+typedef uint8_t (*BL_Delta_Output_t)(uint8_t Byte) ;
+
+typedef struct
+{
+	const uint8_t *Old_Image ;
+	uint32_t Old_Length ;
+	uint32_t Output_Length ;
+	uint32_t Source_Offset ;
+	uint32_t Remaining ;
+	uint32_t Field ;
+	uint8_t  Field_Bytes ;
+	uint8_t  Op ;
+	uint8_t  State ;
+}BL_Delta_Context_t ;
+
+/******************** SW Implementation *******************/
+
+void BL_Delta_Init (BL_Delta_Context_t *Context , const uint8_t *Old_Image , uint32_t Old_Length) ;
+uint8_t BL_Delta_Apply (BL_Delta_Context_t *Context , const uint8_t *Patch , uint32_t Length , BL_Delta_Output_t Output) ;
+
+#endif /* INC_BL_DELTA_H_ */
@@ -0,0 +1,56 @@
+/*
+ * BL_LZ.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+#ifndef INC_BL_LZ_H_
+#define INC_BL_LZ_H_
+
+
+/************************ Include ************************/
+#include <stdint.h>
+#include "main.h"
+
+
+
+/************************ Defines ************************/
+
+/*
+ * Stream format ( LZSS ) :
+ *   Flag byte , then 8 items , flag bit0 first : 1 = literal byte , 0 = match
+ *   Match : byte0 = distance-1 [7:0] , byte1 = distance-1 [11:8] << 4 | L
+ *           length = L + 3 , L = 15 adds one more byte E : length = 18 + E
+ * A frame may end anywhere , even inside a match , the decoder keeps its state.
+ */
+#define BL_LZ_WINDOW_SIZE						4096
+#define BL_LZ_MIN_MATCH							3
+#define BL_LZ_EXTENDED_LENGTH					15
+
+#define LZ_DECODE_OK							1
+#define LZ_DECODE_FAIL							0
+
+
+/***************** DataType Deceleration *****************/
+
+/* Receives every decoded byte , returns LZ_DECODE_OK to continue */
+typedef uint8_t (*BL_LZ_Output_t)(uint8_t Byte) ;
+
+typedef struct
+{
+	uint8_t  Window[BL_LZ_WINDOW_SIZE] ;
+	uint32_t Output_Length ;
+	uint16_t Match_Distance ;
+	uint16_t Match_Length ;
+	uint8_t  Flags ;
+	uint8_t  Flag_Bits_Left ;
+	uint8_t  State ;
+}BL_LZ_Context_t ;
+
+/******************** SW Implementation *******************/
+
+void BL_LZ_Init (BL_LZ_Context_t *Context) ;
+uint8_t BL_LZ_Decode (BL_LZ_Context_t *Context , const uint8_t *Input , uint32_t Length , BL_LZ_Output_t Output) ;
+
+#endif /* INC_BL_LZ_H_ */
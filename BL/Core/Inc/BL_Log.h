@@ -0,0 +1,103 @@
+/*
+ * BL_Log.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+#ifndef INC_BL_LOG_H_
+#define INC_BL_LOG_H_
+
+
+/************************ Include ************************/
+#include <stdint.h>
+#include <string.h>
+#include "main.h"
+#include "usart.h"
+
+
+
+/************************ Defines ************************/
+
+/* Ring of [Length][Payload] entries , size must be a power of 2 */
+#define BL_LOG_RING_SIZE						1024
+#define BL_LOG_RING_MASK						(BL_LOG_RING_SIZE-1)
+/* One DMA transfer , whole entries are packed into it */
+#define BL_LOG_TX_SIZE							128
+/* Longest payload of one entry : format ID + BL_LOG_ARGS_MAX words */
+#define BL_LOG_ARGS_MAX							4
+#define BL_LOG_ENTRY_MAX						((1+BL_LOG_ARGS_MAX)*4)
+
+#define BL_LOG_IDLE								0
+#define BL_LOG_BUSY								1
+
+/* Log Levels , a module logs every call at or below its own level */
+#define BL_LOG_LEVEL_NONE						0
+#define BL_LOG_LEVEL_ERROR						1
+#define BL_LOG_LEVEL_INFO						2
+#define BL_LOG_LEVEL_DEBUG						3
+
+/* Per module levels , a module picks its own with BL_LOG_MODULE_LEVEL */
+#define BL_LOG_LEVEL_BOOTLOADER					BL_LOG_LEVEL_INFO
+#define BL_LOG_LEVEL_RECORD						BL_LOG_LEVEL_ERROR
+
+/*
+ * A call above the module level expands to nothing , neither code nor string is
+ * left in the image. An enabled call puts its format string in .bl_log_fmt , which
+ * is not loaded , and sends only the string address as ID followed by the
+ * arguments as 32 bit words. Tools/bl_log_decode.py rebuilds the text from the ELF.
+ */
+#define BL_LOG_ERROR(...)						BL_LOG_AT(BL_LOG_MODULE_LEVEL, BL_LOG_LEVEL_ERROR, __VA_ARGS__)
+#define BL_LOG_INFO(...)						BL_LOG_AT(BL_LOG_MODULE_LEVEL, BL_LOG_LEVEL_INFO, __VA_ARGS__)
+#define BL_LOG_DEBUG(...)						BL_LOG_AT(BL_LOG_MODULE_LEVEL, BL_LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+/* Extra level so both levels are expanded to digits before pasting */
+#define BL_LOG_AT(Module_Level,Level,...)		BL_LOG_SELECT(Module_Level, Level, __VA_ARGS__)
+#define BL_LOG_SELECT(Module_Level,Level,...)	BL_LOG_ON_##Module_Level##_##Level(__VA_ARGS__)
+
+#define BL_LOG_ON_0_1(...)						do { } while (0)
+#define BL_LOG_ON_0_2(...)						do { } while (0)
+#define BL_LOG_ON_0_3(...)						do { } while (0)
+#define BL_LOG_ON_1_1(...)						BL_LOG_EMIT(__VA_ARGS__)
+#define BL_LOG_ON_1_2(...)						do { } while (0)
+#define BL_LOG_ON_1_3(...)						do { } while (0)
+#define BL_LOG_ON_2_1(...)						BL_LOG_EMIT(__VA_ARGS__)
+#define BL_LOG_ON_2_2(...)						BL_LOG_EMIT(__VA_ARGS__)
+#define BL_LOG_ON_2_3(...)						do { } while (0)
+#define BL_LOG_ON_3_1(...)						BL_LOG_EMIT(__VA_ARGS__)
+#define BL_LOG_ON_3_2(...)						BL_LOG_EMIT(__VA_ARGS__)
+#define BL_LOG_ON_3_3(...)						BL_LOG_EMIT(__VA_ARGS__)
+
+#define BL_LOG_EMIT(Format,...)																\
+	do																						\
+	{																						\
+		static const char BL_Log_Format[] __attribute__((section(".bl_log_fmt"))) = Format ;	\
+		const uint32_t BL_Log_Words[] = { (uint32_t)BL_Log_Format , ##__VA_ARGS__ } ;		\
+		_Static_assert(sizeof(BL_Log_Words) <= BL_LOG_ENTRY_MAX, "Too many log arguments") ;	\
+		BL_Log_Write((const uint8_t *)BL_Log_Words, sizeof(BL_Log_Words)) ;					\
+	} while (0)
+
+
+/***************** DataType Deceleration *****************/
+
+typedef struct
+{
+	/* Free running byte counters , only the producer moves Head */
+	volatile uint32_t Head ;
+	volatile uint32_t Tail ;
+	volatile uint32_t Busy ;
+	volatile uint32_t Dropped ;
+	UART_HandleTypeDef *Port ;
+	uint8_t Ring[BL_LOG_RING_SIZE] ;
+	uint8_t Tx[BL_LOG_TX_SIZE] ;
+}BL_Log_t ;
+
+/******************** SW Implementation *******************/
+
+void BL_Log_Init (UART_HandleTypeDef *Port) ;
+void BL_Log_Write (const uint8_t *Data , uint32_t Length) ;
+void BL_Log_Process (void) ;
+void BL_Log_Flush (void) ;
+uint32_t BL_Log_Dropped (void) ;
+
+#endif /* INC_BL_LOG_H_ */
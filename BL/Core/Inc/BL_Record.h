@@ -0,0 +1,112 @@
+/*
+ * BL_Record.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+#ifndef INC_BL_RECORD_H_
+#define INC_BL_RECORD_H_
+
+
+/************************ Include ************************/
+#include <string.h>
+#include "main.h"
+#include "crc.h"
+#include "BL_Log.h"
+
+
+
+/************************ Defines ************************/
+
+/*
+ * Sectors 10 and 11 are kept out of the application area and hold the bootloader
+ * records. One bank is in use , compaction fills the other one before switching.
+ */
+#define BL_RECORD_BANKS							2
+#define BL_RECORD_BANK_SIZE						(128*1024)
+#define BL_RECORD_BANK_0_SECTOR					FLASH_SECTOR_11
+#define BL_RECORD_BANK_0_BASE					0x080E0000U		/* Also the single area of older bootloaders */
+#define BL_RECORD_BANK_1_SECTOR					FLASH_SECTOR_10
+#define BL_RECORD_BANK_1_BASE					0x080C0000U
+/* Both banks , never written by the host */
+#define BL_RECORD_AREA_BASE						BL_RECORD_BANK_1_BASE
+#define BL_RECORD_AREA_END						(BL_RECORD_BANK_0_BASE+BL_RECORD_BANK_SIZE)
+
+#define BL_RECORD_MAGIC							0x43524C42U		/* "BLRC" */
+#define BL_RECORD_ERASED_WORD					0xFFFFFFFFU
+#define BL_RECORD_CRC_WORDS						6				/* Magic + Type + Data[4] */
+
+/* Records carried over to the other bank when the bank in use is full , Slot and App records first */
+#define BL_RECORD_COMPACT_MAX					8
+
+/* Record Types ( Data.Words[0] is the key of every type ) */
+#define BL_RECORD_TYPE_APP						1
+#define BL_RECORD_TYPE_SLOT						2
+#define BL_RECORD_TYPE_JOURNAL					3
+/* First record of a bank , Data.Words[1] is the generation. Counts once its tally is cleared */
+#define BL_RECORD_TYPE_BANK						4
+#define BL_RECORD_BANK_KEY						0x4B4E4142U		/* "BANK" */
+
+#define RECORD_FOUND							1
+#define RECORD_NOT_FOUND						0
+
+#define RECORD_WRITE_DONE						1
+#define RECORD_WRITE_FAIL						0
+
+
+/***************** DataType Deceleration *****************/
+
+/* Application validity record */
+typedef struct
+{
+	uint32_t Image_Base ;
+	uint32_t Image_Length ;
+	uint32_t Image_CRC ;
+	uint32_t Validated ;
+}BL_App_Record_t ;
+
+/* A/B slot selector , a single record write switches the booting slot */
+typedef struct
+{
+	uint32_t Key ;
+	uint32_t Active_Base ;
+	uint32_t Previous_Base ;
+	uint32_t Sequence ;
+}BL_Slot_Record_t ;
+
+/* Download progress , bytes below Committed_Offset are known to be programmed */
+typedef struct
+{
+	uint32_t Image_Base ;
+	uint32_t Image_Length ;
+	uint32_t Image_ID ;
+	uint32_t Committed_Offset ;
+}BL_Journal_Record_t ;
+
+/* One 32 byte slot of the record area */
+typedef struct
+{
+	uint32_t Magic ;
+	uint32_t Type ;
+	union
+	{
+		BL_App_Record_t App ;
+		BL_Slot_Record_t Slot ;
+		BL_Journal_Record_t Journal ;
+		uint32_t 		Words[4] ;
+	}Data ;
+	uint32_t Record_CRC ;
+	/* Cleared bit by bit after the record is written, not covered by Record_CRC */
+	uint32_t Tally ;
+}BL_Record_t ;
+
+/******************** SW Implementation *******************/
+
+const BL_Record_t *BL_Record_Find (uint32_t Type , uint32_t Key) ;
+const BL_Record_t *BL_Record_Previous (uint32_t Type , const BL_Record_t *Record) ;
+uint8_t BL_Record_Write (uint32_t Type , const uint32_t *Data) ;
+uint32_t BL_Record_Tally_Count (const BL_Record_t *Record) ;
+uint8_t BL_Record_Tally_Increment (const BL_Record_t *Record) ;
+
+#endif /* INC_BL_RECORD_H_ */
@@ -0,0 +1,45 @@
+/*
+ * BL_SHA256.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+#ifndef INC_BL_SHA256_H_
+#define INC_BL_SHA256_H_
+
+
+/************************ Include ************************/
+#include <stdint.h>
+#include <string.h>
+#include "main.h"
+
+
+
+/************************ Defines ************************/
+
+#define BL_SHA256_BLOCK_SIZE					64
+#define BL_SHA256_DIGEST_SIZE					32
+
+
+/***************** DataType Deceleration *****************/
+
+typedef struct
+{
+	uint32_t State[8] ;
+	/* Rolling 16 word message schedule */
+	uint32_t W[16] ;
+	/* Partial block , word typed so it can be loaded word by word */
+	uint32_t Block[BL_SHA256_BLOCK_SIZE/4] ;
+	uint32_t Block_Length ;
+	uint32_t Total_Length_Low ;
+	uint32_t Total_Length_High ;
+}BL_SHA256_Context_t ;
+
+/******************** SW Implementation *******************/
+
+void BL_SHA256_Init (BL_SHA256_Context_t *Context) ;
+void BL_SHA256_Update (BL_SHA256_Context_t *Context , const uint8_t *Data , uint32_t Length) ;
+void BL_SHA256_Final (BL_SHA256_Context_t *Context , uint8_t *Digest) ;
+
+#endif /* INC_BL_SHA256_H_ */
@@ -0,0 +1,75 @@
+/*
+ * BL_Shared.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+#ifndef INC_BL_SHARED_H_
+#define INC_BL_SHARED_H_
+
+/*
+ * Contract between the bootloader and the application , this header is meant to
+ * be copied into the application as is. To get back into the bootloader the
+ * application calls BL_Request_Bootloader() , which leaves the magic word where
+ * the early boot stage looks and resets the core.
+ */
+
+/************************ Include ************************/
+#include <stdint.h>
+#include "main.h"
+
+
+
+/************************ Defines ************************/
+
+/* Where the boot request is left ( the bootloader is built for one of them ) */
+#define BL_BOOT_REQUEST_RAM								0
+#define BL_BOOT_REQUEST_BKP								1
+#define BL_BOOT_REQUEST_SOURCE							BL_BOOT_REQUEST_RAM
+
+/*
+ * Shared no-init RAM at the start of SRAM1 , kept over a reset ( .bl_shared in the linker script ).
+ * The application must not own these bytes , or its startup clears them with .data / .bss before
+ * main and the reset cause and handoff cycles are lost. In the application linker script start RAM
+ * after the block :
+ *
+ *   RAM    (xrw)    : ORIGIN = 0x20000010,   LENGTH = 128K - 16
+ */
+#define BL_SHARED_RAM_BASE								0x20000000U
+#define BL_SHARED_RAM_SIZE								16
+#define BL_BOOT_REQUEST_MAGIC							0x544F4F42U		/* "BOOT" */
+
+
+/***************** DataType Deceleration *****************/
+
+/* Words shared with the application over a reset , never initialised by the startup code */
+typedef struct
+{
+	uint32_t Boot_Request ;		/* BL_BOOT_REQUEST_MAGIC : stay in the bootloader once */
+	uint32_t Decision_Cycles ;	/* BL_Early_Boot entry to the start of the handoff */
+	uint32_t Handoff_Cycles ;	/* Teardown and VTOR relocation , up to the reset handler call */
+	uint32_t Reset_Cause ;		/* RCC->CSR flags of the last reset , as the bootloader found them */
+}BL_Shared_t ;
+
+#define BL_SHARED										((volatile BL_Shared_t *) BL_SHARED_RAM_BASE)
+
+_Static_assert(sizeof(BL_Shared_t) == BL_SHARED_RAM_SIZE, "BL_SHARED_RAM_SIZE is reserved by the application linker script") ;
+
+
+/******************** SW Implementation *******************/
+
+/* Application side : reset into the bootloader host session */
+static inline void BL_Request_Bootloader (void)
+{
+#if BL_BOOT_REQUEST_SOURCE == BL_BOOT_REQUEST_BKP
+	__HAL_RCC_PWR_CLK_ENABLE() ;
+	PWR->CR |= PWR_CR_DBP ;
+	RTC->BKP0R = BL_BOOT_REQUEST_MAGIC ;
+#else
+	BL_SHARED->Boot_Request = BL_BOOT_REQUEST_MAGIC ;
+#endif
+	NVIC_SystemReset() ;
+}
+
+#endif /* INC_BL_SHARED_H_ */
@@ -10,24 +10,61 @@
 
 
 /************************ Include ************************/
-#include <stdio.h>
 #include <string.h>
 #include <strings.h>
-#include <stdarg.h>
 #include "usart.h"
 #include "crc.h"
+#include "BL_Record.h"
+#include "BL_SHA256.h"
+#include "BL_AES.h"
+#include "BL_LZ.h"
+#include "BL_Delta.h"
+#include "BL_Shared.h"
+#include "BL_Log.h"
 
 
 
 /************************ Defines ************************/
 
-#define BL_DEBUG_UART									&huart2
-#define BL_HOST_COMMUNICATION_UART						&huart2
-/* Debug message sent or not */
-#define BL_UART_DEBUG_MESSAGE							BL_ENABLE_DEBUG_MESSAGE
-#define BL_ENABLE_DEBUG_MESSAGE 						 1
-#define BL_DISABLE_DEBUG_MESSAGE						 0
-#define BL_HOST_BUFFER_RX_LENGTH						200
+/* UART ports : 2 is USART2 ( PA2 / PA3 ) , 3 is USART3 ( PB10 / PB11 ) , 0 is none */
+#define BL_PORT_NONE									 0
+#define BL_HOST_PORT									 2
+/* Debug log has its own port , drained by DMA */
+#define BL_DEBUG_PORT									 3
+
+#if (BL_HOST_PORT != 2) && (BL_HOST_PORT != 3)
+#error "BL_HOST_PORT must be 2 or 3"
+#endif
+#if BL_DEBUG_PORT == BL_HOST_PORT
+#error "Log bytes would end up in the host protocol stream , use another BL_DEBUG_PORT or BL_PORT_NONE"
+#endif
+#if (BL_DEBUG_PORT != BL_PORT_NONE) && (BL_DEBUG_PORT != 3)
+#error "Only USART3 has a DMA stream for the log ( usart.c )"
+#endif
+
+/* Extra level so the port number is expanded before pasting */
+#define BL_UART_HANDLE(Port)							BL_UART_HANDLE_OF(Port)
+#define BL_UART_HANDLE_OF(Port)							(&huart##Port)
+
+#define BL_HOST_COMMUNICATION_UART						BL_UART_HANDLE(BL_HOST_PORT)
+#if BL_DEBUG_PORT == BL_PORT_NONE
+#define BL_DEBUG_UART									NULL
+#else
+#define BL_DEBUG_UART									BL_UART_HANDLE(BL_DEBUG_PORT)
+#endif
+/* Length byte + up to 255 bytes */
+#define BL_HOST_BUFFER_RX_LENGTH						256
+/* CPU only data , zero wait state and off the DMA bus matrix path , zeroed by the startup */
+#define BL_CCMRAM										__attribute__((section(".ccmbss")))
+
+/* Early boot : pin held at reset keeps the bootloader ( PA0 , user button ) */
+#define BL_BOOT_PIN_PORT								GPIOA
+#define BL_BOOT_PIN										GPIO_PIN_0
+#define BL_BOOT_PIN_PUPD_MASK							(GPIO_PUPDR_PUPD0)
+#define BL_BOOT_PIN_PULL_DOWN							(GPIO_PUPDR_PUPD0_1)
+#define BL_BOOT_PIN_SETTLE								16
+/* Handoff : 1 leaves the PLL as system clock , the application must then not reconfigure it */
+#define BL_HANDOFF_KEEP_PLL								0
 
 /* Version Related */
 #define BL_VENDOR_ID									100
@@ -40,6 +77,10 @@
 #define CRC_OK 											 1
 #define CRC_NOT_OK 										 0
 
+/* Payload length announced by a frame against the bytes actually received */
+#define FRAME_PAYLOAD_OK								 1
+#define FRAME_PAYLOAD_SHORT								 0
+
 /* Commands List */
 
 #define CBL_GET_VER_CMD					0X10
@@ -54,13 +95,63 @@
 #define CBL_READ_SECTOR_STATUS_CMD		0X19
 #define CBL_OTP_READ_CMD				0X20
 #define CBL_CHANGE_ROP_Level_CMD		0X21
+#define CBL_APP_VALIDATE_CMD			0X22
+#define CBL_IMAGE_DIGEST_CMD			0X23
+#define CBL_DIGEST_BENCH_CMD			0X24
+#define CBL_DECRYPT_SESSION_CMD			0X25
+#define CBL_DECRYPT_BENCH_CMD			0X26
+#define CBL_LZ_SESSION_CMD				0X27
+#define CBL_MEM_WRITE_LZ_CMD			0X28
+#define CBL_DELTA_SESSION_CMD			0X29
+#define CBL_DELTA_DATA_CMD				0X2A
+#define CBL_GET_SLOT_INFO_CMD			0X2B
+#define CBL_ACTIVATE_SLOT_CMD			0X2C
+#define CBL_GET_IMAGE_INFO_CMD			0X2D
+#define CBL_MEM_FILL_CMD				0X2E
+#define CBL_MEM_WRITE_SCATTER_CMD		0X2F
+#define CBL_RAM_EXECUTE_CMD				0X30
+#define CBL_JOURNAL_CMD					0X31
+#define CBL_FLASH_COPY_CMD				0X32
+#define CBL_SYSTEM_RESET_CMD			0X33
+#define CBL_GET_CLOCK_INFO_CMD			0X34
+#define CBL_GET_STATS_CMD				0X35
+#define CBL_LINK_BENCH_CMD				0X36
+#define CBL_GET_MEM_USAGE_CMD			0X37
+
+/* Command Table : one slot per ID in [ BL_COMMAND_FIRST , BL_COMMAND_LAST ] */
+#define BL_COMMAND_FIRST				CBL_GET_VER_CMD
+#define BL_COMMAND_LAST					CBL_GET_MEM_USAGE_CMD
+#define BL_COMMAND_SLOTS				(BL_COMMAND_LAST-BL_COMMAND_FIRST+1)
+/* Shortest frame of a command carrying Payload bytes : length , command , payload , CRC */
+#define BL_COMMAND_MIN_LENGTH(Payload)	(2+(Payload)+CRC_TYPE_SIZE_BYTE)
+/* No mode byte value of the command needs more than the least payload */
+#define BL_CMD_NO_MODE					0xFF
+
+/* Command Capability Flags , reported by Get_Help */
+#define BL_CMD_FLAG_NONE				0x00
+#define BL_CMD_FLAG_FLASH				0x01			/* May erase or program flash */
+#define BL_CMD_FLAG_SESSION				0x02			/* Part of a multi frame session */
+#define BL_CMD_FLAG_STREAM				0x04			/* Raw bytes follow the ACK */
+#define BL_CMD_FLAG_NO_RETURN			0x08			/* May leave the bootloader */
+
+/* Get Help : IDs only , or ( ID , Flags ) pairs when the optional mode byte asks */
+#define BL_HELP_IDS						0
+#define BL_HELP_WITH_FLAGS				1
 
 /* ACK or NACK */
 #define BL_SEND_ACK						0XCD
 #define BL_SEND_NACK					0XAB
 
-/* Sector 2 "Application is there " */
+/* Sector 2 "Application is there " , single image layout ( sectors 2 -> 5 ) */
 #define FLASH_SECTOR2_BASE_ADDRESS 		0x08008000U
+#define BL_APP_AREA_END					BL_SLOT_A_BASE
+/* A/B layout , the slot selector record names the slot that boots . Sectors 10 , 11 hold the records */
+#define BL_SLOT_A_BASE					0x08040000U		/* Sectors 6 -> 7 */
+#define BL_SLOT_B_BASE					0x08080000U		/* Sectors 8 -> 9 */
+#define BL_SLOT_SIZE					(2*128*1024)
+#define BL_SLOT_SELECTOR_KEY			0x544F4C53U		/* "SLOT" */
+/* Flash to flash copy goes through a RAM bounce buffer of this size */
+#define BL_FLASH_COPY_CHUNK				256
 
 /* Address Verification */
 #define ADDRESS_VALID 					1
@@ -76,6 +167,12 @@
 #define STM32F407_SRAM3_END				(CCMDATARAM_BASE+STM32F407_SRAM3_SIZE)
 #define STM32F407_FLASH_END				(FLASH_BASE+STM32F407_FLASH_SIZE)
 
+/* RAM load window , SRAM1 and SRAM2 above the 16K the bootloader data lives in ( checked by the linker script ) */
+#define BL_RAM_LOAD_BASE				(SRAM1_BASE+(16*1024))
+#define BL_RAM_LOAD_END					STM32F407_SRAM2_END
+/* VTOR needs the vector table aligned to its size rounded up to a power of 2 */
+#define BL_VECTOR_TABLE_ALIGN			0x200U
+
 #define ERASE_INVALID					2
 #define ERASE_VALID						3
 #define MASS_ERASE						0xFF
@@ -87,6 +184,106 @@
 #define ROP_LEVEL_CHANGE_VALID			1
 #define ROP_LEVEL_CHANGE_INVALID		0
 
+/* Application Validity */
+#define APP_VALID						1
+#define APP_INVALID						0
+#define BL_APP_VALIDATED				0x444C4156U		/* "VALD" */
+#define BL_APP_NOT_VALIDATED			0x00000000U
+/* Full image CRC every N boots ( 0 : never , record and vectors only ) */
+#define BL_APP_REVERIFY_PERIOD			16
+
+/* Image Digest Modes */
+#define BL_DIGEST_REGION				0
+#define BL_DIGEST_STREAM_START			1
+#define BL_DIGEST_STREAM_FINISH			2
+#define DIGEST_STREAM_IDLE				0
+#define DIGEST_STREAM_ACTIVE			1
+#define DIGEST_DONE						1
+#define DIGEST_FAIL						0
+
+/* Encrypted Download ( AES-128-CTR , counter = Nonce + image offset / 16 ) */
+#define BL_DECRYPT_SESSION_STOP			0
+#define BL_DECRYPT_SESSION_START		1
+#define DECRYPT_SESSION_IDLE			0
+#define DECRYPT_SESSION_ACTIVE			1
+#define DECRYPT_SESSION_DONE			1
+#define DECRYPT_SESSION_FAIL			0
+/*
+ * Product image key , readable only while RDP is at level 0. It is never part of the
+ * sources : BL_Image_Key.h ( ignored by git ) or a -D of the build defines it as a
+ * 16 byte initialiser , and the build stops when neither does.
+ */
+#if !defined(BL_AES_IMAGE_KEY) && __has_include("BL_Image_Key.h")
+#include "BL_Image_Key.h"
+#endif
+#ifndef BL_AES_IMAGE_KEY
+#error "BL_AES_IMAGE_KEY is not provisioned , create Core/Inc/BL_Image_Key.h ( see README )"
+#endif
+
+/* Compressed Download */
+#define BL_LZ_SESSION_FINISH			0
+#define BL_LZ_SESSION_START				1
+#define LZ_SESSION_IDLE					0
+#define LZ_SESSION_ACTIVE				1
+
+/* Delta Update */
+#define BL_DELTA_SESSION_FINISH			0
+#define BL_DELTA_SESSION_START			1
+#define DELTA_SESSION_IDLE				0
+#define DELTA_SESSION_ACTIVE			1
+
+/* A/B Slots */
+#define SLOT_ACTIVATE_DONE				1
+#define SLOT_ACTIVATE_FAIL				0
+
+/* Image Header , optional , the vector table follows it at Image Base + BL_IMAGE_HEADER_SIZE */
+#define BL_IMAGE_HEADER_MAGIC			0x48494C42U		/* "BLIH" */
+#define BL_IMAGE_HEADER_VERSION			1
+#define BL_IMAGE_HEADER_SIZE			0x200			/* Keeps the vector table VTOR aligned */
+#define BL_IMAGE_HEADER_CRC_WORDS		7				/* Every field before Header_CRC */
+#define IMAGE_HEADER_VALID				1
+#define IMAGE_HEADER_NONE				0
+
+/* Download Journal , progress is persisted every granule of contiguous data */
+#define BL_JOURNAL_QUERY				0
+#define BL_JOURNAL_START				1
+#define BL_JOURNAL_CLEAR				2
+#define BL_JOURNAL_GRANULE				4096
+/* Journals of distinct images looked at when an erase takes back their committed part */
+#define BL_JOURNAL_ERASE_MAX			8
+#define JOURNAL_IDLE					0
+#define JOURNAL_ACTIVE					1
+
+/* System Reset */
+#define BL_RESET_TO_APP					0
+#define BL_RESET_TO_BOOTLOADER			1
+
+/* Scatter Write : records of Address (4) , Length (1) , Data in one frame */
+#define BL_SCATTER_RECORD_HEADER		5
+#define BL_SCATTER_MAX_RECORDS			32
+
+/* Command Statistics , one entry per slot of the command table */
+#define BL_STATS_FIRST_CMD				BL_COMMAND_FIRST
+#define BL_STATS_LAST_CMD				BL_COMMAND_LAST
+#define BL_STATS_COMMANDS				BL_COMMAND_SLOTS
+#define BL_STATS_PHASE_RX				0				/* Frame after the length byte */
+#define BL_STATS_PHASE_CRC				1
+#define BL_STATS_PHASE_FLASH			2				/* Erase and program */
+#define BL_STATS_PHASE_TX				3
+#define BL_STATS_PHASES					4
+#define BL_STATS_REPORT_WORDS			(5+BL_STATS_PHASES)
+#define BL_STATS_KEEP					0
+#define BL_STATS_CLEAR					1
+#define STATS_INVALID_COMMAND			0
+
+/* Link Bench : the host streams N raw bytes after the ACK , the report follows them */
+#define BL_LINK_BENCH_SINK				0
+#define BL_LINK_BENCH_ECHO				1
+#define BL_LINK_BENCH_IDLE_TIMEOUT		100				/* ms without a byte ends the stream */
+
+/* Memory Usage : the startup fills [ _sstack , _estack ) with this word */
+#define BL_STACK_PAINT					0xC5C5C5C5U
+
 
 /***************** DataType Deceleration *****************/
 
@@ -96,6 +293,63 @@ typedef enum
 	BL_ACK
 }BL_Status;
 
+/* Collects bytes into whole words for the word wide flash program */
+typedef struct
+{
+	uint32_t Address ;			/* Address of the next byte */
+	uint32_t End_Address ;		/* First address not allowed to be written */
+	uint32_t Word ;				/* Word at Address & ~3 , unwritten bytes kept 0xFF */
+}BL_Write_Combiner_t ;
+
+/*
+ * One receive frame. Data[0] is the length byte and sits one byte past a word
+ * boundary , so the payloads at Data[3] ( LZ , Delta ) and Data[7] ( Memory Write )
+ * are word aligned and are programmed , hashed and decoded in place.
+ */
+typedef struct
+{
+	uint8_t Reserved ;
+	uint8_t Data[BL_HOST_BUFFER_RX_LENGTH] ;
+}__attribute__((aligned(4))) BL_Frame_t ;
+
+/* Cycles of one command ID , Errors counts the frames answered with a NACK */
+typedef struct
+{
+	uint32_t Count ;
+	uint32_t Errors ;
+	uint32_t Min_Cycles ;
+	uint32_t Max_Cycles ;
+	uint64_t Total_Cycles ;
+	uint64_t Phase_Cycles[BL_STATS_PHASES] ;
+}BL_Command_Stats_t ;
+
+/*
+ * Entry of the command table , lengths count the whole frame. A frame whose mode
+ * byte ( Host_Buffer[2] ) equals Mode must be at least Mode_Min_Length long.
+ */
+typedef void (*BL_Command_Handler_t)(uint8_t *Host_Buffer) ;
+typedef struct
+{
+	BL_Command_Handler_t Handler ;
+	uint8_t Min_Length ;
+	uint8_t Mode ;
+	uint8_t Mode_Min_Length ;
+	uint8_t Flags ;
+}BL_Command_t ;
+
+/* First words of an image with a header , the rest of BL_IMAGE_HEADER_SIZE is padding */
+typedef struct
+{
+	uint32_t Magic ;
+	uint32_t Header_Version ;
+	uint32_t Image_Size ;		/* Bytes after the header */
+	uint32_t Load_Address ;		/* Vector table */
+	uint32_t Entry_Address ;	/* Reset handler */
+	uint32_t Image_CRC ;		/* STM32 CRC of the bytes after the header */
+	uint32_t App_Version ;
+	uint32_t Header_CRC ;
+}BL_Image_Header_t ;
+
 /* pointer to function Data Type */
 typedef void (*pMainApp)(void) ;
 typedef void (*Jump_ptr)(void) ; // Used in Jump to certain Address
@@ -103,7 +357,8 @@ typedef void (*Jump_ptr)(void) ; // Used in Jump to certain Address
 /******************** SW Implementation *******************/
 
 
-void Print_Message (char *Format , ...) ;
-BL_Status UART_Fetch_Host_Commands (void) ;
+void BL_Early_Boot (void) ;
+BL_Status BL_UART_Fetch_Host_Commands (void) ;
+uint8_t BL_App_Validity_Check (void) ;
 
 #endif /* INC_BOOTLOADER_H_ */
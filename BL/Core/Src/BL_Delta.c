@@ -0,0 +1,142 @@
+/*
+ * BL_Delta.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+/************** Includes **************/
+
+#include "BL_Delta.h"
+
+/* Decoder states */
+#define DELTA_STATE_OP					0
+#define DELTA_STATE_SOURCE				1
+#define DELTA_STATE_LENGTH				2
+#define DELTA_STATE_DATA				3
+
+/**** Static Function Deceleration ****/
+static uint8_t Delta_Field_Byte (BL_Delta_Context_t *Context , uint8_t Byte) 				;
+static uint8_t Delta_Instruction_Start (BL_Delta_Context_t *Context , BL_Delta_Output_t Output) ;
+
+/**** SW Functions Implementations ****/
+
+/* Collect a little endian word , returns 1 when the 4th byte arrived */
+static uint8_t Delta_Field_Byte (BL_Delta_Context_t *Context , uint8_t Byte)
+{
+	Context->Field |= ((uint32_t)Byte << (8 * Context->Field_Bytes)) ;
+	Context->Field_Bytes++ ;
+
+	return (Context->Field_Bytes == 4) ? 1 : 0 ;
+}
+
+/* Length is known : check the source range , COPY is done right away */
+static uint8_t Delta_Instruction_Start (BL_Delta_Context_t *Context , BL_Delta_Output_t Output)
+{
+	uint8_t Return_Status = DELTA_APPLY_OK ;
+
+	if ((Context->Op != BL_DELTA_OP_INSERT) &&
+		((Context->Source_Offset > Context->Old_Length) || (Context->Remaining > (Context->Old_Length - Context->Source_Offset))))
+	{
+		Return_Status = DELTA_APPLY_FAIL ;
+	}
+	else if (Context->Op == BL_DELTA_OP_COPY)
+	{
+		while ((Context->Remaining != 0) && (Return_Status == DELTA_APPLY_OK))
+		{
+			Return_Status = Output(Context->Old_Image[Context->Source_Offset]) ;
+			Context->Source_Offset++ ;
+			Context->Remaining-- ;
+			Context->Output_Length++ ;
+		}
+	}
+
+	Context->State = (Context->Remaining == 0) ? DELTA_STATE_OP : DELTA_STATE_DATA ;
+
+	return Return_Status ;
+}
+
+void BL_Delta_Init (BL_Delta_Context_t *Context , const uint8_t *Old_Image , uint32_t Old_Length)
+{
+	Context->Old_Image = Old_Image ;
+	Context->Old_Length = Old_Length ;
+	Context->Output_Length = 0 ;
+	Context->Source_Offset = 0 ;
+	Context->Remaining = 0 ;
+	Context->Field = 0 ;
+	Context->Field_Bytes = 0 ;
+	Context->Op = 0 ;
+	Context->State = DELTA_STATE_OP ;
+}
+
+uint8_t BL_Delta_Apply (BL_Delta_Context_t *Context , const uint8_t *Patch , uint32_t Length , BL_Delta_Output_t Output)
+{
+	uint8_t Return_Status = DELTA_APPLY_OK ;
+	uint32_t Patch_Counter ;
+	uint8_t Byte ;
+
+	for (Patch_Counter = 0 ; (Patch_Counter < Length) && (Return_Status == DELTA_APPLY_OK) ; Patch_Counter++)
+	{
+		Byte = Patch[Patch_Counter] ;
+
+		switch (Context->State)
+		{
+		case DELTA_STATE_OP :
+			Context->Op = Byte ;
+			Context->Field = 0 ;
+			Context->Field_Bytes = 0 ;
+			if ((Byte == BL_DELTA_OP_COPY) || (Byte == BL_DELTA_OP_ADD))
+			{
+				Context->State = DELTA_STATE_SOURCE ;
+			}
+			else if (Byte == BL_DELTA_OP_INSERT)
+			{
+				Context->State = DELTA_STATE_LENGTH ;
+			}
+			else
+			{
+				Return_Status = DELTA_APPLY_FAIL ;
+			}
+			break ;
+
+		case DELTA_STATE_SOURCE :
+			if (Delta_Field_Byte(Context, Byte) == 1)
+			{
+				Context->Source_Offset = Context->Field ;
+				Context->Field = 0 ;
+				Context->Field_Bytes = 0 ;
+				Context->State = DELTA_STATE_LENGTH ;
+			}
+			break ;
+
+		case DELTA_STATE_LENGTH :
+			if (Delta_Field_Byte(Context, Byte) == 1)
+			{
+				Context->Remaining = Context->Field ;
+				Return_Status = Delta_Instruction_Start(Context, Output) ;
+			}
+			break ;
+
+		case DELTA_STATE_DATA :
+			if (Context->Op == BL_DELTA_OP_ADD)
+			{
+				Byte = (uint8_t)(Byte + Context->Old_Image[Context->Source_Offset]) ;
+				Context->Source_Offset++ ;
+			}
+			Return_Status = Output(Byte) ;
+			Context->Output_Length++ ;
+			Context->Remaining-- ;
+			if (Context->Remaining == 0)
+			{
+				Context->State = DELTA_STATE_OP ;
+			}
+			break ;
+
+		default :
+			Return_Status = DELTA_APPLY_FAIL ;
+			break ;
+		}
+	}
+
+	return Return_Status ;
+}
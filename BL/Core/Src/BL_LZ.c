@@ -0,0 +1,126 @@
+/*
+ * BL_LZ.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+/************** Includes **************/
+
+#include "BL_LZ.h"
+
+/* Decoder states , one input byte moves it at most one step */
+#define LZ_STATE_FLAGS					0
+#define LZ_STATE_ITEM					1
+#define LZ_STATE_MATCH_HIGH				2
+#define LZ_STATE_MATCH_EXTRA			3
+
+#define LZ_WINDOW_MASK					(BL_LZ_WINDOW_SIZE - 1)
+
+/**** Static Function Deceleration ****/
+static uint8_t LZ_Emit (BL_LZ_Context_t *Context , uint8_t Byte , BL_LZ_Output_t Output) ;
+static uint8_t LZ_Copy_Match (BL_LZ_Context_t *Context , BL_LZ_Output_t Output) ;
+
+/**** SW Functions Implementations ****/
+
+static uint8_t LZ_Emit (BL_LZ_Context_t *Context , uint8_t Byte , BL_LZ_Output_t Output)
+{
+	Context->Window[Context->Output_Length & LZ_WINDOW_MASK] = Byte ;
+	Context->Output_Length++ ;
+
+	return Output(Byte) ;
+}
+
+static uint8_t LZ_Copy_Match (BL_LZ_Context_t *Context , BL_LZ_Output_t Output)
+{
+	uint8_t Return_Status = LZ_DECODE_OK ;
+	uint16_t Byte_Counter ;
+
+	/* Reference before the first output byte is a corrupt stream */
+	if (Context->Match_Distance > Context->Output_Length)
+	{
+		Return_Status = LZ_DECODE_FAIL ;
+	}
+
+	/* Byte by byte so overlapping matches ( runs ) repeat correctly */
+	for (Byte_Counter = 0 ; (Byte_Counter < Context->Match_Length) && (Return_Status == LZ_DECODE_OK) ; Byte_Counter++)
+	{
+		Return_Status = LZ_Emit(Context, Context->Window[(Context->Output_Length - Context->Match_Distance) & LZ_WINDOW_MASK], Output) ;
+	}
+
+	return Return_Status ;
+}
+
+void BL_LZ_Init (BL_LZ_Context_t *Context)
+{
+	Context->Output_Length = 0 ;
+	Context->Match_Distance = 0 ;
+	Context->Match_Length = 0 ;
+	Context->Flags = 0 ;
+	Context->Flag_Bits_Left = 0 ;
+	Context->State = LZ_STATE_FLAGS ;
+}
+
+uint8_t BL_LZ_Decode (BL_LZ_Context_t *Context , const uint8_t *Input , uint32_t Length , BL_LZ_Output_t Output)
+{
+	uint8_t Return_Status = LZ_DECODE_OK ;
+	uint32_t Input_Counter ;
+	uint8_t Byte ;
+
+	for (Input_Counter = 0 ; (Input_Counter < Length) && (Return_Status == LZ_DECODE_OK) ; Input_Counter++)
+	{
+		Byte = Input[Input_Counter] ;
+
+		switch (Context->State)
+		{
+		case LZ_STATE_FLAGS :
+			Context->Flags = Byte ;
+			Context->Flag_Bits_Left = 8 ;
+			Context->State = LZ_STATE_ITEM ;
+			break ;
+
+		case LZ_STATE_ITEM :
+			if ((Context->Flags & 0x01U) != 0)
+			{
+				Return_Status = LZ_Emit(Context, Byte, Output) ;
+				Context->Flags >>= 1 ;
+				Context->Flag_Bits_Left-- ;
+				Context->State = (Context->Flag_Bits_Left == 0) ? LZ_STATE_FLAGS : LZ_STATE_ITEM ;
+			}
+			else
+			{
+				Context->Match_Distance = Byte ;
+				Context->State = LZ_STATE_MATCH_HIGH ;
+			}
+			break ;
+
+		case LZ_STATE_MATCH_HIGH :
+			Context->Match_Distance = (uint16_t)((Context->Match_Distance | ((uint16_t)(Byte >> 4) << 8)) + 1) ;
+			Context->Match_Length = (uint16_t)((Byte & 0x0FU) + BL_LZ_MIN_MATCH) ;
+			if ((Byte & 0x0FU) == BL_LZ_EXTENDED_LENGTH)
+			{
+				Context->State = LZ_STATE_MATCH_EXTRA ;
+				break ;
+			}
+			Return_Status = LZ_Copy_Match(Context, Output) ;
+			Context->Flags >>= 1 ;
+			Context->Flag_Bits_Left-- ;
+			Context->State = (Context->Flag_Bits_Left == 0) ? LZ_STATE_FLAGS : LZ_STATE_ITEM ;
+			break ;
+
+		case LZ_STATE_MATCH_EXTRA :
+			Context->Match_Length = (uint16_t)(Context->Match_Length + Byte) ;
+			Return_Status = LZ_Copy_Match(Context, Output) ;
+			Context->Flags >>= 1 ;
+			Context->Flag_Bits_Left-- ;
+			Context->State = (Context->Flag_Bits_Left == 0) ? LZ_STATE_FLAGS : LZ_STATE_ITEM ;
+			break ;
+
+		default :
+			Return_Status = LZ_DECODE_FAIL ;
+			break ;
+		}
+	}
+
+	return Return_Status ;
+}
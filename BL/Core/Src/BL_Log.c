@@ -0,0 +1,205 @@
+/*
+ * BL_Log.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+/************** Includes **************/
+
+#include "BL_Log.h"
+
+/*
+ * Debug log drained by DMA on its own port. An entry goes on the wire as is ,
+ * [Length][Format ID][Arguments] , see BL_LOG_EMIT. The command path only copies the
+ * message into a ring and returns. The drain is started when the bootloader is
+ * idle and keeps itself going from the transfer complete interrupt until the ring
+ * is empty. Whole entries are moved out of the ring into the DMA buffer , so ring
+ * space is given back as soon as a transfer starts. When the ring is full the
+ * oldest entries are dropped and counted , the writer never waits.
+ * Head belongs to the writer , Tail is moved by both sides with LDREX / STREX.
+ */
+
+/**** Static Function Deceleration ****/
+static uint8_t  Log_Tail_Advance (uint32_t Expected , uint32_t New_Tail) 				;
+static uint32_t Log_Claim (void) 														;
+static void     Log_Start (void) 														;
+
+/**** Global Variables Definitions ****/
+
+/* Kept in main SRAM , the Tx buffer is read by DMA1 , never BL_CCMRAM */
+static BL_Log_t BL_Log ;
+
+/**** SW Functions Implementations ****/
+
+/* Move Tail only if nobody moved it since it was read */
+static uint8_t Log_Tail_Advance (uint32_t Expected , uint32_t New_Tail)
+{
+	uint8_t Advanced = 0 ;
+
+	if (__LDREXW(&BL_Log.Tail) == Expected)
+	{
+		if (__STREXW(New_Tail, &BL_Log.Tail) == 0)
+		{
+			Advanced = 1 ;
+		}
+	}
+	else
+	{
+		__CLREX() ;
+	}
+
+	return Advanced ;
+}
+
+/* Pack whole entries into the Tx buffer and free them , returns the bytes packed */
+static uint32_t Log_Claim (void)
+{
+	uint32_t Start_Tail ;
+	uint32_t Tail ;
+	uint32_t Head ;
+	uint32_t Entry_Length ;
+	uint32_t Tx_Length ;
+	uint32_t Byte_Counter ;
+
+	do
+	{
+		Start_Tail = BL_Log.Tail ;
+		Tail = Start_Tail ;
+		Head = BL_Log.Head ;
+		Tx_Length = 0 ;
+
+		while (Tail != Head)
+		{
+			/* Length byte included , the decoder frames entries with it */
+			Entry_Length = 1 + BL_Log.Ring[Tail & BL_LOG_RING_MASK] ;
+			if ((Tx_Length + Entry_Length) > BL_LOG_TX_SIZE)
+			{
+				break ;
+			}
+			for (Byte_Counter = 0 ; Byte_Counter < Entry_Length ; Byte_Counter++)
+			{
+				BL_Log.Tx[Tx_Length] = BL_Log.Ring[(Tail + Byte_Counter) & BL_LOG_RING_MASK] ;
+				Tx_Length++ ;
+			}
+			Tail += Entry_Length ;
+		}
+	} while ((Tx_Length != 0) && (Log_Tail_Advance(Start_Tail, Tail) == 0)) ;
+
+	return Tx_Length ;
+}
+
+/* Called with Busy owned by the caller , releases it when nothing is left */
+static void Log_Start (void)
+{
+	uint32_t Tx_Length = Log_Claim() ;
+
+	if ((Tx_Length == 0) || (HAL_UART_Transmit_DMA(BL_Log.Port, BL_Log.Tx, (uint16_t)Tx_Length) != HAL_OK))
+	{
+		BL_Log.Busy = BL_LOG_IDLE ;
+	}
+}
+
+void BL_Log_Init (UART_HandleTypeDef *Port)
+{
+	BL_Log.Head = 0 ;
+	BL_Log.Tail = 0 ;
+	BL_Log.Busy = BL_LOG_IDLE ;
+	BL_Log.Dropped = 0 ;
+	BL_Log.Port = Port ;
+}
+
+/* Writer side , thread context only */
+void BL_Log_Write (const uint8_t *Data , uint32_t Length)
+{
+	uint32_t Head = BL_Log.Head ;
+	uint32_t Tail ;
+	uint32_t Byte_Counter ;
+
+	if (BL_Log.Port != NULL)
+	{
+		if (Length > BL_LOG_ENTRY_MAX)
+		{
+			Length = BL_LOG_ENTRY_MAX ;
+		}
+
+		/* Make room by dropping the oldest entries , the drain may free some meanwhile */
+		Tail = BL_Log.Tail ;
+		while ((Head - Tail + 1 + Length) > BL_LOG_RING_SIZE)
+		{
+			if (Log_Tail_Advance(Tail, Tail + 1 + BL_Log.Ring[Tail & BL_LOG_RING_MASK]) == 1)
+			{
+				BL_Log.Dropped++ ;
+			}
+			Tail = BL_Log.Tail ;
+		}
+
+		BL_Log.Ring[Head & BL_LOG_RING_MASK] = (uint8_t)Length ;
+		for (Byte_Counter = 0 ; Byte_Counter < Length ; Byte_Counter++)
+		{
+			BL_Log.Ring[(Head + 1 + Byte_Counter) & BL_LOG_RING_MASK] = Data[Byte_Counter] ;
+		}
+
+		/* Entry bytes must be visible before the drain can see the new Head */
+		__DMB() ;
+		BL_Log.Head = Head + 1 + Length ;
+	}
+}
+
+/* Start the drain if it is stopped , called when the bootloader is idle */
+void BL_Log_Process (void)
+{
+	uint8_t Owned = 0 ;
+
+	if ((BL_Log.Port != NULL) && (BL_Log.Head != BL_Log.Tail))
+	{
+		if (__LDREXW(&BL_Log.Busy) == BL_LOG_IDLE)
+		{
+			Owned = (__STREXW(BL_LOG_BUSY, &BL_Log.Busy) == 0) ;
+		}
+		else
+		{
+			__CLREX() ;
+		}
+
+		if (Owned == 1)
+		{
+			Log_Start() ;
+		}
+	}
+}
+
+/* Wait until every entry is on the wire , used before the port is torn down */
+void BL_Log_Flush (void)
+{
+	if (BL_Log.Port != NULL)
+	{
+		while ((BL_Log.Head != BL_Log.Tail) || (BL_Log.Busy != BL_LOG_IDLE))
+		{
+			BL_Log_Process() ;
+		}
+	}
+}
+
+uint32_t BL_Log_Dropped (void)
+{
+	return BL_Log.Dropped ;
+}
+
+/* Transfer complete , chain the next one from the interrupt */
+void HAL_UART_TxCpltCallback (UART_HandleTypeDef *huart)
+{
+	if (huart == BL_Log.Port)
+	{
+		Log_Start() ;
+	}
+}
+
+/* A failed transfer is not retried , the drain moves on to the next entries */
+void HAL_UART_ErrorCallback (UART_HandleTypeDef *huart)
+{
+	if (huart == BL_Log.Port)
+	{
+		Log_Start() ;
+	}
+}
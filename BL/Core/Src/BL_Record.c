@@ -0,0 +1,364 @@
+/*
+ * BL_Record.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+/************** Includes **************/
+
+#include "BL_Record.h"
+
+#define BL_LOG_MODULE_LEVEL				BL_LOG_LEVEL_RECORD
+
+/*
+ * A record bank is an append only log of 32 byte records. Written records
+ * always form a prefix of the bank, so the first free slot is found with a
+ * binary search and the latest record of a type is found scanning backwards.
+ * When the bank is full the other bank is erased, a bank header is written to
+ * its first slot, the records to keep are copied after it and only then the
+ * header tally is cleared. A bank without a cleared header tally is never
+ * used, so a power loss at any point leaves the old bank in charge.
+ */
+
+#define BL_RECORD_SLOTS				(BL_RECORD_BANK_SIZE/sizeof(BL_Record_t))
+
+/**** Static Function Deceleration ****/
+static uint32_t Record_CRC_Calculate (const BL_Record_t *Record) 						;
+static uint8_t  Record_Is_Valid (const BL_Record_t *Record) 								;
+static uint8_t  Record_Active_Bank (uint32_t *Generation) 								;
+static uint32_t Record_First_Free_Slot (const BL_Record_t *Area) 						;
+static uint8_t  Record_Program (const BL_Record_t *Area , uint32_t Slot , const BL_Record_t *Record) 	;
+static uint8_t  Record_Area_Compact (void) 												;
+
+/**** Global Variables Definitions ****/
+
+static const BL_Record_t * const BL_Record_Bank[BL_RECORD_BANKS] =
+{
+	(const BL_Record_t *)BL_RECORD_BANK_0_BASE,
+	(const BL_Record_t *)BL_RECORD_BANK_1_BASE
+};
+static const uint32_t BL_Record_Bank_Sector[BL_RECORD_BANKS] =
+{
+	BL_RECORD_BANK_0_SECTOR,
+	BL_RECORD_BANK_1_SECTOR
+};
+
+/**** SW Functions Implementations ****/
+
+static uint32_t Record_CRC_Calculate (const BL_Record_t *Record)
+{
+	uint32_t CRC_Value ;
+
+	CRC_Value = HAL_CRC_Calculate(&hcrc, (uint32_t *)Record, BL_RECORD_CRC_WORDS) ;
+
+	/* Leave the CRC unit reset, the host command path accumulates from a clean state */
+	__HAL_CRC_DR_RESET(&hcrc) ;
+
+	return CRC_Value ;
+}
+
+static uint8_t Record_Is_Valid (const BL_Record_t *Record)
+{
+	uint8_t Valid_State = RECORD_NOT_FOUND ;
+
+	if ((Record->Magic == BL_RECORD_MAGIC) && (Record->Record_CRC == Record_CRC_Calculate(Record)))
+	{
+		Valid_State = RECORD_FOUND ;
+	}
+
+	return Valid_State ;
+}
+
+/* Completed bank of the highest generation , bank 0 from generation 0 when no bank is complete */
+static uint8_t Record_Active_Bank (uint32_t *Generation)
+{
+	const BL_Record_t *Header ;
+	uint8_t Active_Bank = 0 ;
+	uint8_t Bank_Found = 0 ;
+	uint8_t Bank ;
+
+	*Generation = 0 ;
+	for (Bank = 0 ; Bank < BL_RECORD_BANKS ; Bank++)
+	{
+		Header = &BL_Record_Bank[Bank][0] ;
+		if ((Header->Type == BL_RECORD_TYPE_BANK) && (Header->Data.Words[0] == BL_RECORD_BANK_KEY) &&
+			(Record_Is_Valid(Header) == RECORD_FOUND) && (BL_Record_Tally_Count(Header) != 0) &&
+			((Bank_Found == 0) || ((int32_t)(Header->Data.Words[1] - *Generation) > 0)))
+		{
+			Active_Bank = Bank ;
+			Bank_Found = 1 ;
+			*Generation = Header->Data.Words[1] ;
+		}
+	}
+
+	return Active_Bank ;
+}
+
+static uint32_t Record_First_Free_Slot (const BL_Record_t *Area)
+{
+	uint32_t Low = 0 ;
+	uint32_t High = BL_RECORD_SLOTS ;
+	uint32_t Middle ;
+
+	/* Magic is the first word programmed, an erased Magic means an unused slot */
+	while (Low < High)
+	{
+		Middle = Low + ((High - Low) / 2) ;
+		if (Area[Middle].Magic == BL_RECORD_ERASED_WORD)
+		{
+			High = Middle ;
+		}
+		else
+		{
+			Low = Middle + 1 ;
+		}
+	}
+
+	return Low ;
+}
+
+static uint8_t Record_Program (const BL_Record_t *Area , uint32_t Slot , const BL_Record_t *Record)
+{
+	uint8_t Return_Status = RECORD_WRITE_FAIL ;
+	HAL_StatusTypeDef Flash_Status = HAL_ERROR ;
+	uint32_t Address = (uint32_t)&Area[Slot] ;
+	const uint32_t *Words = (const uint32_t *)Record ;
+	uint8_t Word_Counter ;
+
+	Flash_Status = HAL_FLASH_Unlock() ;
+	if (Flash_Status == HAL_OK)
+	{
+		Return_Status = RECORD_WRITE_DONE ;
+
+		/* Tally stays erased , it is only ever cleared bit by bit */
+		for (Word_Counter = 0 ; Word_Counter < (sizeof(BL_Record_t)/4) - 1 ; Word_Counter++)
+		{
+			Flash_Status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, Address + (Word_Counter*4), Words[Word_Counter]) ;
+			if (Flash_Status != HAL_OK)
+			{
+				Return_Status = RECORD_WRITE_FAIL ;
+				break ;
+			}
+		}
+	}
+	HAL_FLASH_Lock() ;
+
+	return Return_Status ;
+}
+
+static uint8_t Record_Area_Compact (void)
+{
+	uint32_t Generation ;
+	uint8_t Old_Bank = Record_Active_Bank(&Generation) ;
+	uint8_t New_Bank = Old_Bank ^ 1U ;
+	const BL_Record_t *Area = BL_Record_Bank[Old_Bank] ;
+	BL_Record_t Kept[BL_RECORD_COMPACT_MAX] ;
+	BL_Record_t Header ;
+	uint8_t Kept_Count = 0 ;
+	uint8_t Kept_Counter ;
+	uint8_t Already_Kept ;
+	uint8_t Keep_Pass ;
+	uint8_t Always_Kept ;
+	uint32_t Free_Slot = Record_First_Free_Slot(Area) ;
+	uint32_t Slot ;
+	FLASH_EraseInitTypeDef pEraseInit ;
+	uint32_t Sector_Error = 0 ;
+	HAL_StatusTypeDef Flash_Status = HAL_ERROR ;
+	uint8_t Return_Status = RECORD_WRITE_DONE ;
+
+	/*
+	 * Latest record of every (Type , Key) , newest first. The first pass takes the
+	 * slot selector and the app records , which always fit , journals fill the rest.
+	 */
+	for (Keep_Pass = 0 ; Keep_Pass < 2 ; Keep_Pass++)
+	{
+		Slot = Free_Slot ;
+		while ((Slot > 0) && (Kept_Count < BL_RECORD_COMPACT_MAX))
+		{
+			Slot-- ;
+			Always_Kept = ((Area[Slot].Type == BL_RECORD_TYPE_SLOT) || (Area[Slot].Type == BL_RECORD_TYPE_APP)) ? 1 : 0 ;
+			if ((Area[Slot].Type != BL_RECORD_TYPE_BANK) && (Always_Kept == (Keep_Pass == 0)) &&
+				(Record_Is_Valid(&Area[Slot]) == RECORD_FOUND))
+			{
+				Already_Kept = 0 ;
+				for (Kept_Counter = 0 ; Kept_Counter < Kept_Count ; Kept_Counter++)
+				{
+					if ((Kept[Kept_Counter].Type == Area[Slot].Type) && (Kept[Kept_Counter].Data.Words[0] == Area[Slot].Data.Words[0]))
+					{
+						Already_Kept = 1 ;
+						break ;
+					}
+				}
+				if (Already_Kept == 0)
+				{
+					Kept[Kept_Count] = Area[Slot] ;
+					Kept_Count++ ;
+				}
+			}
+		}
+	}
+
+	/* Only the unused bank is erased , the bank in use stays intact until the switch */
+	pEraseInit.Banks = FLASH_BANK_1 ;
+	pEraseInit.VoltageRange = FLASH_VOLTAGE_RANGE_3 ;
+	pEraseInit.TypeErase = FLASH_TYPEERASE_SECTORS ;
+	pEraseInit.Sector = BL_Record_Bank_Sector[New_Bank] ;
+	pEraseInit.NbSectors = 1 ;
+	Flash_Status = HAL_FLASH_Unlock() ;
+	if (Flash_Status == HAL_OK)
+	{
+		Flash_Status = HAL_FLASHEx_Erase(&pEraseInit, &Sector_Error) ;
+	}
+	HAL_FLASH_Lock() ;
+
+	Header.Magic = BL_RECORD_MAGIC ;
+	Header.Type = BL_RECORD_TYPE_BANK ;
+	Header.Data.Words[0] = BL_RECORD_BANK_KEY ;
+	Header.Data.Words[1] = Generation + 1 ;
+	Header.Data.Words[2] = 0 ;
+	Header.Data.Words[3] = 0 ;
+	Header.Record_CRC = Record_CRC_Calculate(&Header) ;
+	Header.Tally = BL_RECORD_ERASED_WORD ;
+
+	if ((Flash_Status != HAL_OK) || (Sector_Error != 0xFFFFFFFFU))
+	{
+		BL_LOG_ERROR("Record bank erase failed , status %u", Flash_Status) ;
+		Return_Status = RECORD_WRITE_FAIL ;
+	}
+	else if (Record_Program(BL_Record_Bank[New_Bank], 0, &Header) != RECORD_WRITE_DONE)
+	{
+		Return_Status = RECORD_WRITE_FAIL ;
+	}
+	else
+	{
+		/* Write back oldest first so the order of the log is kept */
+		for (Kept_Counter = Kept_Count ; Kept_Counter > 0 ; Kept_Counter--)
+		{
+			if (Record_Program(BL_Record_Bank[New_Bank], 1 + (Kept_Count - Kept_Counter) , &Kept[Kept_Counter - 1]) != RECORD_WRITE_DONE)
+			{
+				Return_Status = RECORD_WRITE_FAIL ;
+				break ;
+			}
+		}
+
+		/* The switch : from here on the new bank is the one in use */
+		if (Return_Status == RECORD_WRITE_DONE)
+		{
+			Return_Status = BL_Record_Tally_Increment(&BL_Record_Bank[New_Bank][0]) ;
+		}
+	}
+
+	return Return_Status ;
+}
+
+/* Latest valid record of a type , Key is compared with Data.Words[0] */
+const BL_Record_t *BL_Record_Find (uint32_t Type , uint32_t Key)
+{
+	uint32_t Generation ;
+	const BL_Record_t *Area = BL_Record_Bank[Record_Active_Bank(&Generation)] ;
+	const BL_Record_t *Found = NULL ;
+	uint32_t Slot = Record_First_Free_Slot(Area) ;
+
+	while (Slot > 0)
+	{
+		Slot-- ;
+		if ((Area[Slot].Type == Type) && (Area[Slot].Data.Words[0] == Key) && (Record_Is_Valid(&Area[Slot]) == RECORD_FOUND))
+		{
+			Found = &Area[Slot] ;
+			break ;
+		}
+	}
+
+	return Found ;
+}
+
+/* Valid record of a type written before Record , the latest one when Record is NULL */
+const BL_Record_t *BL_Record_Previous (uint32_t Type , const BL_Record_t *Record)
+{
+	uint32_t Generation ;
+	const BL_Record_t *Area = BL_Record_Bank[Record_Active_Bank(&Generation)] ;
+	const BL_Record_t *Found = NULL ;
+	uint32_t Slot ;
+
+	Slot = (Record == NULL) ? Record_First_Free_Slot(Area) : (uint32_t)(Record - Area) ;
+	while (Slot > 0)
+	{
+		Slot-- ;
+		if ((Area[Slot].Type == Type) && (Record_Is_Valid(&Area[Slot]) == RECORD_FOUND))
+		{
+			Found = &Area[Slot] ;
+			break ;
+		}
+	}
+
+	return Found ;
+}
+
+/* Append a new record , Data points to the 4 type specific words */
+uint8_t BL_Record_Write (uint32_t Type , const uint32_t *Data)
+{
+	uint8_t Return_Status = RECORD_WRITE_FAIL ;
+	BL_Record_t Record ;
+	uint32_t Generation ;
+	const BL_Record_t *Area ;
+	uint32_t Slot ;
+
+	Record.Magic = BL_RECORD_MAGIC ;
+	Record.Type = Type ;
+	memcpy(Record.Data.Words, Data, sizeof(Record.Data.Words)) ;
+	Record.Record_CRC = Record_CRC_Calculate(&Record) ;
+	Record.Tally = BL_RECORD_ERASED_WORD ;
+
+	Area = BL_Record_Bank[Record_Active_Bank(&Generation)] ;
+	Slot = Record_First_Free_Slot(Area) ;
+	if (Slot >= BL_RECORD_SLOTS)
+	{
+		if (Record_Area_Compact() == RECORD_WRITE_DONE)
+		{
+			Area = BL_Record_Bank[Record_Active_Bank(&Generation)] ;
+			Slot = Record_First_Free_Slot(Area) ;
+		}
+	}
+
+	if (Slot < BL_RECORD_SLOTS)
+	{
+		Return_Status = Record_Program(Area, Slot, &Record) ;
+	}
+	else
+	{
+		BL_LOG_ERROR("Record area full , type %u dropped", Type) ;
+	}
+
+	return Return_Status ;
+}
+
+/* Number of tally bits already cleared */
+uint32_t BL_Record_Tally_Count (const BL_Record_t *Record)
+{
+	return (uint32_t)(32 - __builtin_popcount(Record->Tally)) ;
+}
+
+/* Clear the next tally bit , flash allows 1 -> 0 without an erase */
+uint8_t BL_Record_Tally_Increment (const BL_Record_t *Record)
+{
+	uint8_t Return_Status = RECORD_WRITE_FAIL ;
+	HAL_StatusTypeDef Flash_Status = HAL_ERROR ;
+	uint32_t Tally = Record->Tally ;
+
+	if (Tally != 0)
+	{
+		Flash_Status = HAL_FLASH_Unlock() ;
+		if (Flash_Status == HAL_OK)
+		{
+			Flash_Status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, (uint32_t)&Record->Tally, Tally << 1) ;
+			if (Flash_Status == HAL_OK)
+			{
+				Return_Status = RECORD_WRITE_DONE ;
+			}
+		}
+		HAL_FLASH_Lock() ;
+	}
+
+	return Return_Status ;
+}
@@ -0,0 +1,208 @@
+/*
+ * BL_SHA256.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Ahmed
+ */
+
+/************** Includes **************/
+
+#include "BL_SHA256.h"
+
+/*
+ * FIPS 180-4 SHA-256 for the F407 , which has no HASH unit.
+ * Rounds are unrolled by 8 and the working variables rotate through the
+ * macro arguments , so no register shuffling is done between rounds.
+ * Word aligned input is hashed in place , anything else goes through the
+ * word typed block buffer of the context.
+ */
+
+#define ROTR(x,n)				(((x) >> (n)) | ((x) << (32 - (n))))
+#define BSIG0(x)				(ROTR((x),2) ^ ROTR((x),13) ^ ROTR((x),22))
+#define BSIG1(x)				(ROTR((x),6) ^ ROTR((x),11) ^ ROTR((x),25))
+#define SSIG0(x)				(ROTR((x),7) ^ ROTR((x),18) ^ ((x) >> 3))
+#define SSIG1(x)				(ROTR((x),17) ^ ROTR((x),19) ^ ((x) >> 10))
+#define CH(x,y,z)				((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x,y,z)				(((x) & (y)) | ((z) & ((x) | (y))))
+
+/* Schedule word i ( i >= 16 ) computed in place in the 16 word window */
+#define SCHEDULE(W,i)			(W[(i)&15] += SSIG1(W[((i)-2)&15]) + W[((i)-7)&15] + SSIG0(W[((i)-15)&15]))
+
+#define ROUND(a,b,c,d,e,f,g,h,Ki,Wi)								\
+	do																\
+	{																\
+		uint32_t T1 = (h) + BSIG1(e) + CH((e),(f),(g)) + (Ki) + (Wi) ;	\
+		(d) += T1 ;													\
+		(h)  = T1 + BSIG0(a) + MAJ((a),(b),(c)) ;					\
+	} while (0)
+
+#define EIGHT_ROUNDS(i,Wx)												\
+	do																	\
+	{																	\
+		ROUND(A,B,C,D,E,F,G,H,K[(i)+0],Wx((i)+0)) ;						\
+		ROUND(H,A,B,C,D,E,F,G,K[(i)+1],Wx((i)+1)) ;						\
+		ROUND(G,H,A,B,C,D,E,F,K[(i)+2],Wx((i)+2)) ;						\
+		ROUND(F,G,H,A,B,C,D,E,K[(i)+3],Wx((i)+3)) ;						\
+		ROUND(E,F,G,H,A,B,C,D,K[(i)+4],Wx((i)+4)) ;						\
+		ROUND(D,E,F,G,H,A,B,C,K[(i)+5],Wx((i)+5)) ;						\
+		ROUND(C,D,E,F,G,H,A,B,K[(i)+6],Wx((i)+6)) ;						\
+		ROUND(B,C,D,E,F,G,H,A,K[(i)+7],Wx((i)+7)) ;						\
+	} while (0)
+
+#define W_LOAD(i)				(W[(i)])
+#define W_NEXT(i)				SCHEDULE(W,(i))
+
+/**** Static Function Deceleration ****/
+static void SHA256_Transform (BL_SHA256_Context_t *Context , const uint32_t *Block) ;
+
+/**** Global Variables Definitions ****/
+
+static const uint32_t K[64] =
+{
+	0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU, 0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U,
+	0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U, 0xc19bf174U,
+	0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU, 0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU,
+	0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U, 0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U,
+	0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU, 0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
+	0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U, 0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U,
+	0x19a4c116U, 0x1e376c08U, 0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
+	0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U, 0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U
+};
+
+/**** SW Functions Implementations ****/
+
+/* Block must be word aligned , words are big endian on the wire */
+static void SHA256_Transform (BL_SHA256_Context_t *Context , const uint32_t *Block)
+{
+	uint32_t *W = Context->W ;
+	uint32_t A = Context->State[0] ;
+	uint32_t B = Context->State[1] ;
+	uint32_t C = Context->State[2] ;
+	uint32_t D = Context->State[3] ;
+	uint32_t E = Context->State[4] ;
+	uint32_t F = Context->State[5] ;
+	uint32_t G = Context->State[6] ;
+	uint32_t H = Context->State[7] ;
+	uint8_t  Round_Counter ;
+
+	for (Round_Counter = 0 ; Round_Counter < 16 ; Round_Counter++)
+	{
+		W[Round_Counter] = __REV(Block[Round_Counter]) ;
+	}
+
+	EIGHT_ROUNDS(0,W_LOAD) ;
+	EIGHT_ROUNDS(8,W_LOAD) ;
+
+	for (Round_Counter = 16 ; Round_Counter < 64 ; Round_Counter += 8)
+	{
+		EIGHT_ROUNDS(Round_Counter,W_NEXT) ;
+	}
+
+	Context->State[0] += A ;
+	Context->State[1] += B ;
+	Context->State[2] += C ;
+	Context->State[3] += D ;
+	Context->State[4] += E ;
+	Context->State[5] += F ;
+	Context->State[6] += G ;
+	Context->State[7] += H ;
+}
+
+void BL_SHA256_Init (BL_SHA256_Context_t *Context)
+{
+	Context->State[0] = 0x6a09e667U ;
+	Context->State[1] = 0xbb67ae85U ;
+	Context->State[2] = 0x3c6ef372U ;
+	Context->State[3] = 0xa54ff53aU ;
+	Context->State[4] = 0x510e527fU ;
+	Context->State[5] = 0x9b05688cU ;
+	Context->State[6] = 0x1f83d9abU ;
+	Context->State[7] = 0x5be0cd19U ;
+	Context->Block_Length = 0 ;
+	Context->Total_Length_Low = 0 ;
+	Context->Total_Length_High = 0 ;
+}
+
+void BL_SHA256_Update (BL_SHA256_Context_t *Context , const uint8_t *Data , uint32_t Length)
+{
+	uint32_t Copy_Length ;
+
+	Context->Total_Length_Low += Length ;
+	if (Context->Total_Length_Low < Length)
+	{
+		Context->Total_Length_High++ ;
+	}
+
+	/* Complete a pending partial block first */
+	if (Context->Block_Length != 0)
+	{
+		Copy_Length = BL_SHA256_BLOCK_SIZE - Context->Block_Length ;
+		if (Copy_Length > Length)
+		{
+			Copy_Length = Length ;
+		}
+		memcpy((uint8_t *)Context->Block + Context->Block_Length, Data, Copy_Length) ;
+		Context->Block_Length += Copy_Length ;
+		Data += Copy_Length ;
+		Length -= Copy_Length ;
+
+		if (Context->Block_Length == BL_SHA256_BLOCK_SIZE)
+		{
+			SHA256_Transform(Context, Context->Block) ;
+			Context->Block_Length = 0 ;
+		}
+	}
+
+	/* Whole blocks : in place when aligned , bounced through the context otherwise */
+	while (Length >= BL_SHA256_BLOCK_SIZE)
+	{
+		if (((uint32_t)Data & 0x3U) == 0)
+		{
+			SHA256_Transform(Context, (const uint32_t *)Data) ;
+		}
+		else
+		{
+			memcpy(Context->Block, Data, BL_SHA256_BLOCK_SIZE) ;
+			SHA256_Transform(Context, Context->Block) ;
+		}
+		Data += BL_SHA256_BLOCK_SIZE ;
+		Length -= BL_SHA256_BLOCK_SIZE ;
+	}
+
+	if (Length != 0)
+	{
+		memcpy(Context->Block, Data, Length) ;
+		Context->Block_Length = Length ;
+	}
+}
+
+void BL_SHA256_Final (BL_SHA256_Context_t *Context , uint8_t *Digest)
+{
+	uint8_t *Block = (uint8_t *)Context->Block ;
+	uint32_t Bit_Length_High = (Context->Total_Length_High << 3) | (Context->Total_Length_Low >> 29) ;
+	uint32_t Bit_Length_Low  = Context->Total_Length_Low << 3 ;
+	uint8_t  Word_Counter ;
+
+	Block[Context->Block_Length] = 0x80 ;
+	Context->Block_Length++ ;
+
+	if (Context->Block_Length > (BL_SHA256_BLOCK_SIZE - 8))
+	{
+		memset(Block + Context->Block_Length, 0, BL_SHA256_BLOCK_SIZE - Context->Block_Length) ;
+		SHA256_Transform(Context, Context->Block) ;
+		Context->Block_Length = 0 ;
+	}
+
+	memset(Block + Context->Block_Length, 0, (BL_SHA256_BLOCK_SIZE - 8) - Context->Block_Length) ;
+	Context->Block[14] = __REV(Bit_Length_High) ;
+	Context->Block[15] = __REV(Bit_Length_Low) ;
+	SHA256_Transform(Context, Context->Block) ;
+
+	for (Word_Counter = 0 ; Word_Counter < 8 ; Word_Counter++)
+	{
+		Digest[(Word_Counter*4) + 0] = (uint8_t)(Context->State[Word_Counter] >> 24) ;
+		Digest[(Word_Counter*4) + 1] = (uint8_t)(Context->State[Word_Counter] >> 16) ;
+		Digest[(Word_Counter*4) + 2] = (uint8_t)(Context->State[Word_Counter] >> 8) ;
+		Digest[(Word_Counter*4) + 3] = (uint8_t)(Context->State[Word_Counter]) ;
+	}
+}
@@ -9,6 +9,8 @@
 
 #include "Bootloader.h"
 
+#define BL_LOG_MODULE_LEVEL					BL_LOG_LEVEL_BOOTLOADER
+
 /**** Static Function Deceleration ****/
 static void 	BL_Get_Version(uint8_t *Host_Buffer) 								  										;
 static void     BL_Get_Help(uint8_t *Host_Buffer)    								  										;
@@ -18,73 +20,206 @@ static void     BL_Jump_To_Address(uint8_t *Host_Buffer)
 static void     BL_Erase_Flash(uint8_t *Host_Buffer)               					  										;
 static void     BL_Memory_Write(uint8_t *Host_Buffer)                				  										;
 static void 	BL_Change_Read_Protection(uint8_t *Host_Buffer)																	;
+static void 	BL_Validate_App(uint8_t *Host_Buffer)																			;
+static void 	BL_Image_Digest(uint8_t *Host_Buffer)																			;
+static void 	BL_Digest_Bench(uint8_t *Host_Buffer)																			;
+static void 	BL_Decrypt_Session(uint8_t *Host_Buffer)																		;
+static void 	BL_Decrypt_Bench(uint8_t *Host_Buffer)																			;
+static void 	BL_LZ_Session(uint8_t *Host_Buffer)																				;
+static void 	BL_Memory_Write_LZ(uint8_t *Host_Buffer)																		;
+static void 	BL_Delta_Session(uint8_t *Host_Buffer)																			;
+static void 	BL_Delta_Data(uint8_t *Host_Buffer)																				;
+static void 	BL_Get_Slot_Info(uint8_t *Host_Buffer)																			;
+static void 	BL_Activate_Slot(uint8_t *Host_Buffer)																			;
+static void 	BL_Get_Image_Info(uint8_t *Host_Buffer)																			;
+static void 	BL_Memory_Fill(uint8_t *Host_Buffer)																			;
+static void 	BL_Memory_Write_Scatter(uint8_t *Host_Buffer)																	;
+static void 	BL_RAM_Execute(uint8_t *Host_Buffer)																			;
+static void 	BL_Journal(uint8_t *Host_Buffer)																				;
+static void 	BL_Flash_Copy(uint8_t *Host_Buffer)																				;
+static void 	BL_System_Reset(uint8_t *Host_Buffer)																			;
+static void 	BL_Get_Clock_Info(uint8_t *Host_Buffer)																			;
+static void 	BL_Get_Stats(uint8_t *Host_Buffer)																				;
+static void 	BL_Link_Bench(uint8_t *Host_Buffer)																				;
+static void 	BL_Get_Mem_Usage(uint8_t *Host_Buffer)																			;
 
 static uint8_t 	CRC_Verify(uint8_t *pData , uint32_t Data_Len , uint32_t HOST_CRC) 											;
 static void 	Send_ACK_Reply(uint8_t Reply_Len) 								  											;
 static void 	Send_NACK()														  											;
+static void 	Host_Transmit(uint8_t *pData , uint16_t Data_Len) 															;
+static HAL_StatusTypeDef Flash_Program(uint32_t Type_Program , uint32_t Address , uint64_t Data) 							;
+static HAL_StatusTypeDef Flash_Erase(FLASH_EraseInitTypeDef *pEraseInit , uint32_t *Sector_Error) 							;
+static void 	Stats_Begin (void) 																							;
+static void 	Stats_End (uint8_t Command , uint32_t Cycles) 																;
 
 static void 	Jump_To_User_App (void)											 											;
 static uint8_t 	HOST_Jump_Address_Verification(uint32_t Host_Address)			  											;
 static uint8_t  Perform_Flash_Erase(uint8_t Sector_Number , uint8_t Number_of_Sectors) 							  			;
 static uint8_t  Flash_Memory_Write_Payload(uint8_t *Host_Payload , uint32_t Payload_Start_Address , uint32_t Payloadlen) 	;
+static uint8_t  Flash_Memory_Fill(uint32_t Fill_Start_Address , uint32_t Fill_Length , uint32_t Pattern) 					;
+static uint8_t  Ram_Load_Verification (uint32_t Region_Base , uint32_t Region_Length) 										;
+static uint8_t  Ram_Memory_Write_Payload(uint8_t *Host_Payload , uint32_t Payload_Start_Address , uint32_t Payloadlen) 		;
+static void 	Image_Handoff (uint32_t Vector_Base) 																		;
+static void 	Journal_Progress (uint32_t Address , uint32_t Length) 														;
+static void 	Journal_Invalidate_Range (uint32_t Range_Start , uint32_t Range_End) 										;
+static uint8_t  Boot_Pin_Requested (void) 																					;
+static uint8_t  Boot_Request_Taken (void) 																					;
+static uint8_t  Flash_Copy (uint32_t Source , uint32_t Destination , uint32_t Length) 										;
 static uint8_t  Get_RDP_Level (void)																						;
 static uint8_t  Change_RDP_Level (uint32_t RDP_Level) 																		;
+static uint32_t Flash_Image_CRC (uint32_t Image_Base , uint32_t Image_Length) 												;
+static uint8_t  Vector_Table_Sanity (uint32_t Image_Base , uint32_t Image_Length) 											;
+static uint8_t  Image_Header_Parse (uint32_t Image_Base , BL_Image_Header_t *Header) 										;
+static uint32_t Image_Vector_Base (uint32_t Image_Base) 																	;
+static void 	App_Record_Invalidate (uint32_t Image_Base) 																;
+static void 	App_Record_Invalidate_Range (uint32_t Range_Start , uint32_t Range_End) 									;
+static void 	Cycle_Counter_Enable (void) 																				;
+static uint8_t  Host_Region_Verification (uint32_t Region_Base , uint32_t Region_Length) 									;
+static uint8_t  Frame_Payload_Check (uint8_t *Host_Buffer , uint8_t Header_Length , uint8_t Payload_Length) 				;
+static void 	Write_Combiner_Start (uint32_t Address , uint32_t End_Address) 												;
+static uint8_t  Write_Combiner_Put (uint8_t Byte) 																			;
+static uint8_t  Write_Combiner_Flush (void) 																				;
+static uint8_t  LZ_Output_To_Flash (uint8_t Byte) 																			;
+static uint8_t  Delta_Output_To_Flash (uint8_t Byte) 																		;
+static uint8_t  Flash_Sector_Number (uint32_t Address) 																	;
+static uint8_t  Flash_Erase_Range (uint32_t Address , uint32_t Length) 														;
+static uint8_t  Image_Validity_Check (uint32_t Image_Base) 																	;
+static uint32_t Image_Area_Size (uint32_t Image_Base) 																		;
+static uint32_t Active_Image_Base (void) 																					;
+static uint32_t Inactive_Slot_Base (void) 																					;
+static uint8_t  Slot_Activate (uint32_t Slot_Base) 																		;
+static uint8_t  Flash_Region_Writable (uint32_t Region_Start , uint32_t Region_End) 										;
+/**** Linker Symbols ****/
+extern uint32_t _sstack ;
+extern uint32_t _estack ;
+extern uint32_t _sdata ;
+extern uint32_t _edata ;
+extern uint32_t _sbss ;
+extern uint32_t _ebss ;
+extern uint32_t _sccmram ;
+extern uint32_t _eccmbss ;
+extern uint32_t _end ;
+extern uint32_t _Min_Heap_Size ;
+
 /**** Global Variables Definitions ****/
 
-static uint8_t BL_Host_Buffer[BL_HOST_BUFFER_RX_LENGTH] ;
-static uint8_t BL_Supported_Commands [12] =
-{
-		CBL_GET_VER_CMD,
-		CBL_GET_HELP_CMD ,
-		CBL_GET_CID_CMD ,
-		CBL_GET_RDP_STATUS_CMD ,
-		CBL_GO_TO_ADDR_CMD ,
-		CBL_FLASH_ERASE_CMD ,
-		CBL_MEM_WRITE_CMD ,
-		CBL_EN_R_W_PROTECT_CMD ,
-		CBL_MEM_READ_CMD,
-		CBL_READ_SECTOR_STATUS_CMD ,
-		CBL_OTP_READ_CMD ,
-		CBL_CHANGE_ROP_Level_CMD
+/* The one receive frame , fetch is synchronous . Filled by the CPU from the UART registers , so it */
+/* can live in CCMRAM . Never cleared */
+static BL_Frame_t BL_Host_Frame BL_CCMRAM ;
+/* Survives a reset , placed first in RAM before .data by the linker script */
+BL_Shared_t BL_Shared __attribute__((section(".bl_shared"))) ;
+/* SHA-256 working sets , initialised by BL_SHA256_Init before any use */
+static BL_SHA256_Context_t BL_Digest_Stream_Context BL_CCMRAM ;
+static BL_SHA256_Context_t BL_Digest_Region_Context BL_CCMRAM ;
+static uint8_t BL_Digest_Stream_State = DIGEST_STREAM_IDLE ;
+/* AES-CTR round keys and keystream , initialised by BL_AES_Init before any use */
+static BL_AES_Context_t BL_Decrypt_Context BL_CCMRAM ;
+static uint8_t BL_Decrypt_Session_State = DECRYPT_SESSION_IDLE ;
+static uint32_t BL_Decrypt_Image_Base ;
+static const uint8_t BL_AES_Key[BL_AES_KEY_SIZE] = BL_AES_IMAGE_KEY ;
+/* Decrypt_Bench works on this , never on the command frame the dispatcher still reads */
+static uint8_t BL_Bench_Buffer[BL_HOST_BUFFER_RX_LENGTH] __attribute__((aligned(4))) BL_CCMRAM ;
+/* LZ window , the whole RAM budget of the compressed download */
+static BL_LZ_Context_t BL_LZ_Context BL_CCMRAM ;
+static uint8_t BL_LZ_Session_State = LZ_SESSION_IDLE ;
+static BL_Write_Combiner_t BL_Write_Combiner BL_CCMRAM ;
+static BL_Delta_Context_t BL_Delta_Context BL_CCMRAM ;
+static uint8_t BL_Delta_Session_State = DELTA_SESSION_IDLE ;
+static uint32_t BL_Delta_New_Length ;
+static uint32_t BL_Delta_New_CRC ;
+static uint32_t BL_Delta_Target_Base ;
+/* Download journal , Committed_Offset here runs ahead of the persisted record */
+static BL_Journal_Record_t BL_Journal_Record ;
+static uint32_t BL_Journal_Persisted ;
+static uint8_t BL_Journal_State = JOURNAL_IDLE ;
+/* Cycle statistics per command , and the phases of the command being served */
+static BL_Command_Stats_t BL_Command_Stats[BL_STATS_COMMANDS] ;
+static uint32_t BL_Stats_Phase[BL_STATS_PHASES] ;
+static uint8_t BL_Stats_Error ;
+/* Set by a clearing Get_Stats , so the table is still empty once that command ends */
+static uint8_t BL_Stats_Skip ;
+/* Image picked by BL_App_Validity_Check */
+static uint32_t BL_Boot_Image_Base = FLASH_SECTOR2_BASE_ADDRESS ;
+/* Start address of every sector , plus the end of flash */
+static const uint32_t BL_Flash_Sector_Address[FLASH_SECTOR_TOTAL+1] =
+{
+		0x08000000U, 0x08004000U, 0x08008000U, 0x0800C000U,
+		0x08010000U, 0x08020000U, 0x08040000U, 0x08060000U,
+		0x08080000U, 0x080A0000U, 0x080C0000U, 0x080E0000U,
+		0x08100000U
 };
-
-/**** SW Functions Implementations ****/
-
-/* For Debugging */
-void Print_Message (char *Format , ...)
+/*
+ * Every served command : ID , handler , least payload bytes between the command
+ * byte and the CRC , the mode byte value needing a longer payload and that payload ,
+ * capability flags. The dispatch table , the length checks and the Get_Help
+ * replies are all generated from this one list.
+ */
+#define BL_COMMAND_LIST(X)																																			\
+	X(CBL_GET_VER_CMD			, BL_Get_Version						, 0		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NONE)							\
+	X(CBL_GET_HELP_CMD			, BL_Get_Help							, 0		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NONE)							\
+	X(CBL_GET_CID_CMD			, BL_Get_Chip_Identification_Number		, 0		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NONE)							\
+	X(CBL_GET_RDP_STATUS_CMD	, BL_Read_Protection_Level				, 0		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NONE)							\
+	X(CBL_GO_TO_ADDR_CMD		, BL_Jump_To_Address					, 4		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NO_RETURN)					\
+	X(CBL_FLASH_ERASE_CMD		, BL_Erase_Flash						, 2		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_FLASH)						\
+	X(CBL_MEM_WRITE_CMD			, BL_Memory_Write						, 5		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_FLASH)						\
+	X(CBL_CHANGE_ROP_Level_CMD	, BL_Change_Read_Protection				, 1		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_FLASH)						\
+	X(CBL_APP_VALIDATE_CMD		, BL_Validate_App						, 12	, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_FLASH)						\
+	X(CBL_IMAGE_DIGEST_CMD		, BL_Image_Digest						, 1		, BL_DIGEST_REGION				, 9		, BL_CMD_FLAG_SESSION)						\
+	X(CBL_DIGEST_BENCH_CMD		, BL_Digest_Bench						, 4		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NONE)							\
+	X(CBL_DECRYPT_SESSION_CMD	, BL_Decrypt_Session					, 1		, BL_DECRYPT_SESSION_START		, 21	, BL_CMD_FLAG_SESSION)						\
+	X(CBL_DECRYPT_BENCH_CMD		, BL_Decrypt_Bench						, 4		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NONE)							\
+	X(CBL_LZ_SESSION_CMD		, BL_LZ_Session							, 1		, BL_LZ_SESSION_START			, 9		, BL_CMD_FLAG_SESSION)						\
+	X(CBL_MEM_WRITE_LZ_CMD		, BL_Memory_Write_LZ					, 1		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_FLASH|BL_CMD_FLAG_SESSION)	\
+	X(CBL_DELTA_SESSION_CMD		, BL_Delta_Session						, 1		, BL_DELTA_SESSION_START		, 17	, BL_CMD_FLAG_SESSION)						\
+	X(CBL_DELTA_DATA_CMD		, BL_Delta_Data							, 1		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_FLASH|BL_CMD_FLAG_SESSION)	\
+	X(CBL_GET_SLOT_INFO_CMD		, BL_Get_Slot_Info						, 0		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NONE)							\
+	X(CBL_ACTIVATE_SLOT_CMD		, BL_Activate_Slot						, 4		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_FLASH)						\
+	X(CBL_GET_IMAGE_INFO_CMD	, BL_Get_Image_Info						, 4		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NONE)							\
+	X(CBL_MEM_FILL_CMD			, BL_Memory_Fill						, 12	, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_FLASH)						\
+	X(CBL_MEM_WRITE_SCATTER_CMD	, BL_Memory_Write_Scatter				, 1		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_FLASH)						\
+	X(CBL_RAM_EXECUTE_CMD		, BL_RAM_Execute						, 12	, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NO_RETURN)					\
+	X(CBL_JOURNAL_CMD			, BL_Journal							, 5		, BL_JOURNAL_START				, 13	, BL_CMD_FLAG_FLASH|BL_CMD_FLAG_SESSION)	\
+	X(CBL_FLASH_COPY_CMD		, BL_Flash_Copy							, 12	, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_FLASH)						\
+	X(CBL_SYSTEM_RESET_CMD		, BL_System_Reset						, 1		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NO_RETURN)					\
+	X(CBL_GET_CLOCK_INFO_CMD	, BL_Get_Clock_Info						, 0		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NONE)							\
+	X(CBL_GET_STATS_CMD			, BL_Get_Stats							, 2		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NONE)							\
+	X(CBL_LINK_BENCH_CMD		, BL_Link_Bench							, 5		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_STREAM)						\
+	X(CBL_GET_MEM_USAGE_CMD		, BL_Get_Mem_Usage						, 0		, BL_CMD_NO_MODE				, 0		, BL_CMD_FLAG_NONE)
+
+/* Indexed by ID , an ID out of range fails the build , unlisted IDs stay NULL */
+#define BL_COMMAND_ENTRY(Id,Handler,Payload,Mode,Mode_Payload,Flags)	\
+		[(Id)-BL_COMMAND_FIRST] = {Handler , BL_COMMAND_MIN_LENGTH(Payload) , Mode , BL_COMMAND_MIN_LENGTH(Mode_Payload) , Flags} ,
+static const BL_Command_t BL_Command_Table[BL_COMMAND_SLOTS] =
 {
+		BL_COMMAND_LIST(BL_COMMAND_ENTRY)
+};
+#define BL_COMMAND_ID(Id,Handler,Payload,Mode,Mode_Payload,Flags)			Id ,
+static const uint8_t BL_Supported_Commands [] =
+{
+		BL_COMMAND_LIST(BL_COMMAND_ID)
+};
+#define BL_COMMAND_ID_FLAGS(Id,Handler,Payload,Mode,Mode_Payload,Flags)	Id , Flags ,
+static const uint8_t BL_Supported_Commands_Flags [] =
+{
+		BL_COMMAND_LIST(BL_COMMAND_ID_FLAGS)
+};
 
-	char  Message[100] = {0} ;
-
-	va_list args ;
-
-	va_start(args,Format) ;
-
-	vsprintf(Message,Format,args) ;
-
-#if BL_UART_DEBUG_MESSAGE == BL_ENABLE_DEBUG_MESSAGE
-
-	HAL_UART_Transmit(BL_DEBUG_UART , (uint8_t *)Message , sizeof(Message) , HAL_MAX_DELAY) ;
-
-#endif
-
-	va_end(args) ;
-}
+/**** SW Functions Implementations ****/
 
 /* Calculate CRC among data Received and check if it correct or not */
 static uint8_t 	CRC_Verify(uint8_t *pData , uint32_t Data_Len , uint32_t HOST_CRC)
 {
 	uint8_t CRC_State = CRC_NOT_OK ;
 	uint32_t CRC_Value ;
-	uint8_t DataCounter ;
-	uint32_t Data_Buffer ;
+	uint32_t DataCounter ;
+	uint32_t Start_Cycles = DWT->CYCCNT ;
 
-	/* Calculate CRC on Data */
+	/* Calculate CRC on Data , every byte is fed as one word straight from the frame */
 	for (DataCounter = 0 ; DataCounter < Data_Len ; DataCounter ++)
 	{
-		Data_Buffer = (uint32_t)pData[DataCounter] ;
-		CRC_Value = HAL_CRC_Accumulate(&hcrc, &Data_Buffer,1) ;
+		hcrc.Instance->DR = (uint32_t)pData[DataCounter] ;
 	}
+	CRC_Value = hcrc.Instance->DR ;
 
 	__HAL_CRC_DR_RESET(&hcrc) ;
 
@@ -93,6 +228,8 @@ static uint8_t 	CRC_Verify(uint8_t *pData , uint32_t Data_Len , uint32_t HOST_CR
 		CRC_State = CRC_OK ;
 	}
 
+	BL_Stats_Phase[BL_STATS_PHASE_CRC] += DWT->CYCCNT - Start_Cycles ;
+
 	return CRC_State ;
 
 }
@@ -103,96 +240,123 @@ static void Send_ACK_Reply(uint8_t Reply_Len)
 	uint8_t ACK_Value[2] ;
 	ACK_Value[0] = BL_SEND_ACK ;
 	ACK_Value[1] = Reply_Len ;
-	HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, ACK_Value, 2, HAL_MAX_DELAY) ;
+	Host_Transmit(ACK_Value, 2) ;
 }
 /* Send NACK in case of NACK */
 static void Send_NACK()
 {
 	uint8_t ACK_Value ;
 	ACK_Value = BL_SEND_NACK ;
-	HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &ACK_Value, 1, HAL_MAX_DELAY) ;
+	BL_Stats_Error = 1 ;
+	Host_Transmit(&ACK_Value, 1) ;
 }
 
-static void BL_Get_Version(uint8_t *Host_Buffer)
+/* Every reply goes through here so its wire time is charged to the command */
+static void Host_Transmit(uint8_t *pData , uint16_t Data_Len)
 {
-	uint8_t BL_Version[4] = {BL_VENDOR_ID,BL_MAJOR_VER,BL_MINOR_VER,BL_PATCH_VER};
-	uint16_t HOST_Whole_Packet_Length = 0 ;
-	uint32_t HOST_CRC32 = 0 ;
-	uint8_t CRC_State ;
+	uint32_t Start_Cycles = DWT->CYCCNT ;
 
-	/* Whole packet length (Including the first Byte ) */
-	HOST_Whole_Packet_Length = Host_Buffer[0] + 1 ;
+	HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, pData, Data_Len, HAL_MAX_DELAY) ;
 
-	/* Store CRC value (4 Byte) */
-	HOST_CRC32 = *(uint32_t *)(Host_Buffer + HOST_Whole_Packet_Length - CRC_TYPE_SIZE_BYTE) ;
+	BL_Stats_Phase[BL_STATS_PHASE_TX] += DWT->CYCCNT - Start_Cycles ;
+}
 
-	/* CRC Verification */
-	CRC_State = CRC_Verify (Host_Buffer,2,HOST_CRC32) ;
-	if (CRC_State == CRC_OK)
-	{
-		Send_ACK_Reply(4) ;
-		HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, BL_Version, 4, HAL_MAX_DELAY) ;
-	}
-	else
+static HAL_StatusTypeDef Flash_Program(uint32_t Type_Program , uint32_t Address , uint64_t Data)
+{
+	HAL_StatusTypeDef Flash_Status ;
+	uint32_t Start_Cycles = DWT->CYCCNT ;
+
+	Flash_Status = HAL_FLASH_Program(Type_Program, Address, Data) ;
+
+	BL_Stats_Phase[BL_STATS_PHASE_FLASH] += DWT->CYCCNT - Start_Cycles ;
+
+	return Flash_Status ;
+}
+
+static HAL_StatusTypeDef Flash_Erase(FLASH_EraseInitTypeDef *pEraseInit , uint32_t *Sector_Error)
+{
+	HAL_StatusTypeDef Flash_Status ;
+	uint32_t Start_Cycles = DWT->CYCCNT ;
+
+	Flash_Status = HAL_FLASHEx_Erase(pEraseInit, Sector_Error) ;
+
+	BL_Stats_Phase[BL_STATS_PHASE_FLASH] += DWT->CYCCNT - Start_Cycles ;
+
+	return Flash_Status ;
+}
+
+/* Phases of the next command start from zero */
+static void Stats_Begin (void)
+{
+	memset(BL_Stats_Phase, 0, sizeof(BL_Stats_Phase)) ;
+	BL_Stats_Error = 0 ;
+	BL_Stats_Skip = 0 ;
+}
+
+/* Fold the command just served into its entry , unknown IDs are not kept */
+static void Stats_End (uint8_t Command , uint32_t Cycles)
+{
+	BL_Command_Stats_t *Stats ;
+	uint8_t Phase_Counter ;
+
+	/* Only commands of BL_COMMAND_LIST are timed , unknown IDs are answered without a handler */
+	if ((BL_Stats_Skip == 0) && (Command >= BL_STATS_FIRST_CMD) && (Command < (BL_STATS_FIRST_CMD + BL_STATS_COMMANDS)) &&
+		(BL_Command_Table[Command - BL_COMMAND_FIRST].Handler != NULL))
 	{
-		Send_NACK() ;
-	}
+		Stats = &BL_Command_Stats[Command - BL_STATS_FIRST_CMD] ;
 
+		if ((Stats->Count == 0) || (Cycles < Stats->Min_Cycles))
+		{
+			Stats->Min_Cycles = Cycles ;
+		}
+		if (Cycles > Stats->Max_Cycles)
+		{
+			Stats->Max_Cycles = Cycles ;
+		}
+		Stats->Count++ ;
+		Stats->Errors += BL_Stats_Error ;
+		Stats->Total_Cycles += Cycles ;
+		for (Phase_Counter = 0 ; Phase_Counter < BL_STATS_PHASES ; Phase_Counter++)
+		{
+			Stats->Phase_Cycles[Phase_Counter] += BL_Stats_Phase[Phase_Counter] ;
+		}
+	}
 }
 
-static void  BL_Get_Help(uint8_t *Host_Buffer)
+static void BL_Get_Version(uint8_t *Host_Buffer)
 {
-	uint16_t HOST_Whole_Packet_Length = 0 ;
-	uint32_t HOST_CRC32 = 0 ;
-	uint8_t CRC_State ;
+	uint8_t BL_Version[4] = {BL_VENDOR_ID,BL_MAJOR_VER,BL_MINOR_VER,BL_PATCH_VER};
 
-	/* Whole packet length (Including the first Byte ) */
-	HOST_Whole_Packet_Length = Host_Buffer[0] + 1 ;
+	Send_ACK_Reply(4) ;
+	Host_Transmit(BL_Version, 4) ;
 
-	/* Store CRC value (4 Byte) */
-	HOST_CRC32 = *(uint32_t *)(Host_Buffer + HOST_Whole_Packet_Length - CRC_TYPE_SIZE_BYTE) ;
+}
 
-	/* CRC Verification */
-	CRC_State = CRC_Verify (Host_Buffer,HOST_Whole_Packet_Length-4,HOST_CRC32) ;
-	if (CRC_State == CRC_OK)
+static void  BL_Get_Help(uint8_t *Host_Buffer)
+{
+	/* The mode byte is optional , a bare frame keeps the IDs only reply */
+	if ((Host_Buffer[0] + 1 > BL_COMMAND_MIN_LENGTH(0)) && (Host_Buffer[2] == BL_HELP_WITH_FLAGS))
 	{
-		Send_ACK_Reply(12) ;
-		HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, BL_Supported_Commands, 12, HAL_MAX_DELAY) ;
+		Send_ACK_Reply(sizeof(BL_Supported_Commands_Flags)) ;
+		Host_Transmit((uint8_t *)BL_Supported_Commands_Flags, sizeof(BL_Supported_Commands_Flags)) ;
 	}
 	else
 	{
-		Send_NACK() ;
+		Send_ACK_Reply(sizeof(BL_Supported_Commands)) ;
+		Host_Transmit((uint8_t *)BL_Supported_Commands, sizeof(BL_Supported_Commands)) ;
 	}
 
 }
 
 static void  BL_Get_Chip_Identification_Number(uint8_t *Host_Buffer)
 {
-	uint16_t HOST_Whole_Packet_Length = 0 ;
 	uint16_t MCU_ID_Number ;
-	uint32_t HOST_CRC32 = 0 ;
-	uint8_t CRC_State ;
-
-	/* Whole packet length (Including the first Byte ) */
-	HOST_Whole_Packet_Length = Host_Buffer[0] + 1 ;
 
-	/* Store CRC value (4 Byte) */
-	HOST_CRC32 = *(uint32_t *)(Host_Buffer + HOST_Whole_Packet_Length - CRC_TYPE_SIZE_BYTE) ;
-
-	/* CRC Verification */
-	CRC_State = CRC_Verify (Host_Buffer,HOST_Whole_Packet_Length-4,HOST_CRC32) ;
-	if (CRC_State == CRC_OK)
-	{
-		/* Get Chip Identification Number (only LS 11 bit i want )  */
-		MCU_ID_Number = (uint16_t)(DBGMCU->IDCODE & (0x00000FFF)) ;
+	/* Get Chip Identification Number (only LS 11 bit i want )  */
+	MCU_ID_Number = (uint16_t)(DBGMCU->IDCODE & (0x00000FFF)) ;
 
-		Send_ACK_Reply(2) ;
-		HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, (uint8_t*)&MCU_ID_Number,2,HAL_MAX_DELAY) ;
-	}
-	else
-	{
-		Send_NACK() ;
-	}
+	Send_ACK_Reply(2) ;
+	Host_Transmit((uint8_t*)&MCU_ID_Number, 2) ;
 }
 
 /* Make sure Address that Host want to jump to is valid or not */
@@ -228,81 +392,43 @@ static uint8_t Get_RDP_Level (void)
 }
 static void BL_Read_Protection_Level(uint8_t *Host_Buffer)
 {
-	uint16_t HOST_Whole_Packet_Length = 0 ;
-	uint32_t HOST_CRC32 = 0 ;
-	uint8_t CRC_State ;
 	uint8_t Acquired_Level = 0 ;
 
-	/* Whole packet length (Including the first Byte ) */
-	HOST_Whole_Packet_Length = Host_Buffer[0] + 1 ;
-
-	/* Store CRC value (4 Byte) */
-	HOST_CRC32 = *(uint32_t *)(Host_Buffer + HOST_Whole_Packet_Length - CRC_TYPE_SIZE_BYTE) ;
-
-	/* CRC Verification */
-	CRC_State = CRC_Verify (Host_Buffer,HOST_Whole_Packet_Length-4,HOST_CRC32) ;
-
-	if (CRC_State == CRC_OK)
-	{
-		Send_ACK_Reply(1) ;
+	Send_ACK_Reply(1) ;
 
-		/* Read Protection Level */
-		Acquired_Level = Get_RDP_Level() ;
-		/* Report Protection Level */
-		HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &Acquired_Level,1,HAL_MAX_DELAY) ;
-	}
-	else
-	{
-		Send_NACK() ;
-	}
+	/* Read Protection Level */
+	Acquired_Level = Get_RDP_Level() ;
+	/* Report Protection Level */
+	Host_Transmit(&Acquired_Level, 1) ;
 
 }
 
 /* To Jump to a certain Address whatever the place */
 static void BL_Jump_To_Address(uint8_t *Host_Buffer)
 {
-	uint16_t HOST_Whole_Packet_Length = 0 ;
-	uint32_t HOST_CRC32 = 0 ;
-	uint8_t CRC_State ;
 	uint32_t HOST_Jump_Add = 0 ;
 	uint8_t Address_Verification = ADDRESS_INVALID ;
 
-	/* Whole packet length (Including the first Byte ) */
-	HOST_Whole_Packet_Length = Host_Buffer[0] + 1 ;
-
-	/* Store CRC value (4 Byte) */
-	HOST_CRC32 = *(uint32_t *)(Host_Buffer + HOST_Whole_Packet_Length - CRC_TYPE_SIZE_BYTE) ;
-
-	/* CRC Verification */
-	CRC_State = CRC_Verify (Host_Buffer,HOST_Whole_Packet_Length-4,HOST_CRC32) ;
 
 
+	Send_ACK_Reply(1) ;
 
-	if (CRC_State == CRC_OK)
-	{
-		Send_ACK_Reply(1) ;
-
-		/* Extract Desired Address */
-		HOST_Jump_Add = *((uint32_t*)&Host_Buffer[2]) ;
-		/* Address Verification */
-		Address_Verification = HOST_Jump_Address_Verification(HOST_Jump_Add) ;
-			if (Address_Verification == ADDRESS_VALID)
-			{
-				// Add 1 as indication of Thumb not ARM instruction
-				Jump_ptr Jump_Address = (Jump_ptr) (HOST_Jump_Add+1) ;
-				Print_Message("Jump to : 0x%X \r\n",Jump_Address) ;
-				HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &Address_Verification,1,HAL_MAX_DELAY) ;
-				Jump_Address() ;
+	/* Extract Desired Address */
+	HOST_Jump_Add = *((uint32_t*)&Host_Buffer[2]) ;
+	/* Address Verification */
+	Address_Verification = HOST_Jump_Address_Verification(HOST_Jump_Add) ;
+		if (Address_Verification == ADDRESS_VALID)
+		{
+			// Add 1 as indication of Thumb not ARM instruction
+			Jump_ptr Jump_Address = (Jump_ptr) (HOST_Jump_Add+1) ;
+			BL_LOG_INFO("Jump to : 0x%X", (uint32_t)Jump_Address) ;
+			Host_Transmit(&Address_Verification, 1) ;
+			Jump_Address() ;
  			}
-			else
-			{
-				HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &Address_Verification,1,HAL_MAX_DELAY) ;
-			}
-	}
-	else
-	{
-		Send_NACK() ;
-	}
+		else
+		{
+			Host_Transmit(&Address_Verification, 1) ;
+		}
 
 }
 
@@ -312,19 +438,40 @@ static uint8_t  Perform_Flash_Erase(uint8_t Sector_Number , uint8_t Number_of_Se
 	FLASH_EraseInitTypeDef pEraseInit ;
 	HAL_StatusTypeDef Flash_Status = HAL_ERROR;
 	uint32_t Sector_Error = 0 ;
+	uint8_t Region_Writable = ADDRESS_VALID ;
+	uint8_t Sector_Counter ;
 
+	/*
+	 * No chip erase : it would take the bootloader , the record area and the booting
+	 * slot with it. Every sector the host may write is erased one by one instead.
+	 */
 	if (Sector_Number == MASS_ERASE)
 	{
-		pEraseInit.Banks = FLASH_BANK_1 ;  					/* BANK 1 */
-		pEraseInit.VoltageRange = FLASH_VOLTAGE_RANGE_3 ;	 /*Device operating range: 2.7V to 3.6V */
-		pEraseInit.TypeErase = FLASH_TYPEERASE_MASSERASE ;
-		Flash_Status = HAL_FLASH_Unlock() ;
-		Flash_Status = HAL_FLASHEx_Erase(&pEraseInit, &Sector_Error) ;
-		if (SUCCESSFUL_ERASE_REPORT ==Sector_Error && Flash_Status==HAL_OK )
+		Erase_Status = ERASE_VALID ;
+		for (Sector_Counter = FLASH_SECTOR_2 ; Sector_Counter < FLASH_SECTOR_TOTAL ; Sector_Counter++)
 		{
-			Erase_Status = ERASE_VALID ;
+			if ((Flash_Region_Writable(BL_Flash_Sector_Address[Sector_Counter], BL_Flash_Sector_Address[Sector_Counter + 1]) == ADDRESS_VALID) &&
+				(Perform_Flash_Erase(Sector_Counter, 1) != ERASE_VALID))
+			{
+				Erase_Status = ERASE_INVALID ;
+			}
+		}
+	}
+	else if ((Sector_Number + Number_of_Sectors) <= FLASH_SECTOR_TOTAL)
+	{
+		/* The bootloader , the record area and the booting slot stay untouched */
+		Region_Writable = Flash_Region_Writable(BL_Flash_Sector_Address[Sector_Number], BL_Flash_Sector_Address[Sector_Number + Number_of_Sectors]) ;
+		if (Region_Writable == ADDRESS_VALID)
+		{
+			/* Any erase of the application image ends its validity , and of a committed download part its progress */
+			App_Record_Invalidate_Range(BL_Flash_Sector_Address[Sector_Number], BL_Flash_Sector_Address[Sector_Number + Number_of_Sectors]) ;
+			Journal_Invalidate_Range(BL_Flash_Sector_Address[Sector_Number], BL_Flash_Sector_Address[Sector_Number + Number_of_Sectors]) ;
 		}
+	}
 
+	if ((Region_Writable != ADDRESS_VALID) || (Sector_Number == MASS_ERASE))
+	{
+		/* Refused , or already done sector by sector */
 	}
 	else if ((Sector_Number >=0) && (Sector_Number<=11) && ((Sector_Number+Number_of_Sectors)<=11))
 	{
@@ -334,7 +481,7 @@ static uint8_t  Perform_Flash_Erase(uint8_t Sector_Number , uint8_t Number_of_Se
 		pEraseInit.Sector = Sector_Number ;
 		pEraseInit.NbSectors = Number_of_Sectors  ;
 		Flash_Status = HAL_FLASH_Unlock() ;
-		Flash_Status = HAL_FLASHEx_Erase(&pEraseInit, &Sector_Error) ;
+		Flash_Status = Flash_Erase(&pEraseInit, &Sector_Error) ;
 		if (SUCCESSFUL_ERASE_REPORT == Sector_Error && Flash_Status==HAL_OK )
 		{
 			Erase_Status = ERASE_VALID ;
@@ -347,51 +494,31 @@ static uint8_t  Perform_Flash_Erase(uint8_t Sector_Number , uint8_t Number_of_Se
 }
 static void BL_Erase_Flash(uint8_t *Host_Buffer)
 {
-
-	uint16_t HOST_Whole_Packet_Length = 0 ;
-	uint32_t HOST_CRC32 = 0 ;
-	uint8_t CRC_State ;
 	uint8_t Erase_Verification = ERASE_INVALID ;
 
-	/* Whole packet length (Including the first Byte ) */
-	HOST_Whole_Packet_Length = Host_Buffer[0] + 1 ;
-
-	/* Store CRC value (4 Byte) */
-	HOST_CRC32 = *(uint32_t *)(Host_Buffer + HOST_Whole_Packet_Length - CRC_TYPE_SIZE_BYTE) ;
-
-	/* CRC Verification */
-	CRC_State = CRC_Verify (Host_Buffer,HOST_Whole_Packet_Length-4,HOST_CRC32) ;
-
+	/* One ACK like every other command , the frame was checked by the dispatcher */
 	Send_ACK_Reply(1) ;
 
-	if (CRC_State == CRC_OK)
+	/* Erase Verification */
+	Erase_Verification = Perform_Flash_Erase(Host_Buffer[2],Host_Buffer[3]);
+	if (Erase_Verification == ERASE_VALID)
 	{
-		Send_ACK_Reply(1) ;
-		/* Erase Verification */
-		Erase_Verification = Perform_Flash_Erase(Host_Buffer[2],Host_Buffer[3]);
-			if (Erase_Verification == ERASE_VALID)
-			{
-				/* Report Erase Succeeded */
-				HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &Erase_Verification,1,HAL_MAX_DELAY) ;
-
- 			}
-			else
-			{
-				/* Report Erase Failed */
-				HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &Erase_Verification,1,HAL_MAX_DELAY) ;
-			}
+		/* Report Erase Succeeded */
+		Host_Transmit(&Erase_Verification, 1) ;
 	}
 	else
 	{
-		Send_NACK() ;
+		/* Report Erase Failed */
+		Host_Transmit(&Erase_Verification, 1) ;
 	}
-
 }
+/* Bytes up to the first word boundary , then whole words , then the tail bytes */
 static uint8_t Flash_Memory_Write_Payload(uint8_t *Host_Payload , uint32_t Payload_Start_Address , uint32_t Payloadlen)
 {
 	uint8_t Return_Status = FLASH_WRITE_FAIL ;
 	HAL_StatusTypeDef Flash_Status = HAL_ERROR;
-	uint16_t Payload_Counter = 0 ;
+	uint32_t Payload_Counter = 0 ;
+	uint32_t Payload_Word ;
 
 	Flash_Status = HAL_FLASH_Unlock() ;
 	if (Flash_Status != HAL_OK)
@@ -400,74 +527,258 @@ static uint8_t Flash_Memory_Write_Payload(uint8_t *Host_Payload , uint32_t Paylo
 	}
 	else
 	{
-	for (Payload_Counter = 0 ; Payload_Counter < Payloadlen ; Payload_Counter++ )
+		while ((Payload_Counter < Payloadlen) && (Flash_Status == HAL_OK))
+		{
+			if ((((Payload_Start_Address + Payload_Counter) & 0x3U) == 0) && ((Payloadlen - Payload_Counter) >= 4))
+			{
+				/* Frame payloads are word aligned , other sources take the unaligned load */
+				if (((uint32_t)&Host_Payload[Payload_Counter] & 0x3U) == 0)
+				{
+					Payload_Word = *((const uint32_t *)&Host_Payload[Payload_Counter]) ;
+				}
+				else
+				{
+					Payload_Word = __UNALIGNED_UINT32_READ(&Host_Payload[Payload_Counter]) ;
+				}
+				Flash_Status = Flash_Program(FLASH_TYPEPROGRAM_WORD,(Payload_Start_Address+Payload_Counter) ,Payload_Word) ;
+				Payload_Counter += 4 ;
+			}
+			else
+			{
+				Flash_Status = Flash_Program(FLASH_TYPEPROGRAM_BYTE,(Payload_Start_Address+Payload_Counter) ,(uint64_t)(Host_Payload[Payload_Counter])) ;
+				Payload_Counter++ ;
+			}
+		}
+		Return_Status = (Flash_Status == HAL_OK) ? FLASH_WRITE_DONE : FLASH_WRITE_FAIL ;
+	}
+	Flash_Status = HAL_FLASH_Lock() ;
+
+	return Return_Status ;
+
+}
+
+/* Whole region inside the RAM load window */
+static uint8_t Ram_Load_Verification (uint32_t Region_Base , uint32_t Region_Length)
+{
+	uint8_t Return_Status = ADDRESS_INVALID ;
+
+	if ((Region_Base >= BL_RAM_LOAD_BASE) && (Region_Base < BL_RAM_LOAD_END) &&
+		(Region_Length <= (BL_RAM_LOAD_END - Region_Base)))
+	{
+		Return_Status = ADDRESS_VALID ;
+	}
+
+	return Return_Status ;
+}
+
+/* RAM load , no erase or program cycle . Only the load window is written */
+static uint8_t Ram_Memory_Write_Payload(uint8_t *Host_Payload , uint32_t Payload_Start_Address , uint32_t Payloadlen)
+{
+	uint8_t Return_Status = FLASH_WRITE_FAIL ;
+
+	if (Ram_Load_Verification(Payload_Start_Address, Payloadlen) == ADDRESS_VALID)
+	{
+		memcpy((uint8_t *)Payload_Start_Address, Host_Payload, Payloadlen) ;
+		Return_Status = FLASH_WRITE_DONE ;
+	}
+
+	return Return_Status ;
+}
+
+/*
+ * Byte n of the pattern lands on addresses with (Address & 3) == n , so a fill
+ * gives the same bytes wherever it starts. Words already holding the pattern
+ * are not programmed , a 0xFF fill over erased flash only reads it. Every word
+ * is read back , programming cannot clear a 0 bit so a target that was not
+ * erased fails here.
+ */
+static uint8_t Flash_Memory_Fill(uint32_t Fill_Start_Address , uint32_t Fill_Length , uint32_t Pattern)
+{
+	uint8_t Return_Status = FLASH_WRITE_FAIL ;
+	HAL_StatusTypeDef Flash_Status = HAL_ERROR;
+	uint32_t Address = Fill_Start_Address ;
+	uint32_t Fill_End_Address = Fill_Start_Address + Fill_Length ;
+	uint8_t Pattern_Byte ;
+
+	Flash_Status = HAL_FLASH_Unlock() ;
+	if (Flash_Status == HAL_OK)
 	{
-		Flash_Status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_BYTE,(Payload_Start_Address+Payload_Counter) ,(uint64_t)(Host_Payload[Payload_Counter])) ;
-		if (Flash_Status != HAL_OK)
+		while ((Address < Fill_End_Address) && (Flash_Status == HAL_OK))
 		{
-			Return_Status = FLASH_WRITE_FAIL ;
-			break ;
+			if (((Address & 0x3U) == 0) && ((Fill_End_Address - Address) >= 4))
+			{
+				if (*((volatile uint32_t *)Address) != Pattern)
+				{
+					Flash_Status = Flash_Program(FLASH_TYPEPROGRAM_WORD, Address, Pattern) ;
+				}
+				if ((Flash_Status == HAL_OK) && (*((volatile uint32_t *)Address) != Pattern))
+				{
+					Flash_Status = HAL_ERROR ;
+				}
+				Address += 4 ;
+			}
+			else
+			{
+				Pattern_Byte = (uint8_t)(Pattern >> ((Address & 0x3U) * 8)) ;
+				if (*((volatile uint8_t *)Address) != Pattern_Byte)
+				{
+					Flash_Status = Flash_Program(FLASH_TYPEPROGRAM_BYTE, Address, Pattern_Byte) ;
+				}
+				if ((Flash_Status == HAL_OK) && (*((volatile uint8_t *)Address) != Pattern_Byte))
+				{
+					Flash_Status = HAL_ERROR ;
+				}
+				Address++ ;
+			}
 		}
-			Return_Status = FLASH_WRITE_DONE ;
+		Return_Status = (Flash_Status == HAL_OK) ? FLASH_WRITE_DONE : FLASH_WRITE_FAIL ;
 	}
+	HAL_FLASH_Lock() ;
+
+	return Return_Status ;
+}
+
+static void Write_Combiner_Start (uint32_t Address , uint32_t End_Address)
+{
+	BL_Write_Combiner.Address = Address ;
+	BL_Write_Combiner.End_Address = End_Address ;
+	BL_Write_Combiner.Word = 0xFFFFFFFFU ;
+}
+
+/* Flash must be unlocked , a word is programmed each time one is complete */
+static uint8_t Write_Combiner_Put (uint8_t Byte)
+{
+	uint8_t Return_Status = FLASH_WRITE_FAIL ;
+	uint32_t Byte_Shift = (BL_Write_Combiner.Address & 0x3U) * 8 ;
+
+	if (BL_Write_Combiner.Address < BL_Write_Combiner.End_Address)
+	{
+		Return_Status = FLASH_WRITE_DONE ;
+		BL_Write_Combiner.Word &= ~(0xFFU << Byte_Shift) ;
+		BL_Write_Combiner.Word |= ((uint32_t)Byte << Byte_Shift) ;
+		BL_Write_Combiner.Address++ ;
+
+		if ((BL_Write_Combiner.Address & 0x3U) == 0)
+		{
+			if (Flash_Program(FLASH_TYPEPROGRAM_WORD, BL_Write_Combiner.Address - 4, BL_Write_Combiner.Word) != HAL_OK)
+			{
+				Return_Status = FLASH_WRITE_FAIL ;
+			}
+			BL_Write_Combiner.Word = 0xFFFFFFFFU ;
+		}
 	}
-	Flash_Status = HAL_FLASH_Lock() ;
 
 	return Return_Status ;
+}
+
+/* Program a partial last word , 0xFF bytes leave flash untouched */
+static uint8_t Write_Combiner_Flush (void)
+{
+	uint8_t Return_Status = FLASH_WRITE_DONE ;
+
+	if ((BL_Write_Combiner.Address & 0x3U) != 0)
+	{
+		if ((HAL_FLASH_Unlock() != HAL_OK) ||
+			(Flash_Program(FLASH_TYPEPROGRAM_WORD, BL_Write_Combiner.Address & ~0x3U, BL_Write_Combiner.Word) != HAL_OK))
+		{
+			Return_Status = FLASH_WRITE_FAIL ;
+		}
+		HAL_FLASH_Lock() ;
+		BL_Write_Combiner.Word = 0xFFFFFFFFU ;
+	}
 
+	return Return_Status ;
 }
 /* I mean by Memory here is flash */
 static void BL_Memory_Write(uint8_t *Host_Buffer)
 {
-	uint16_t HOST_Whole_Packet_Length = 0 ;
-	uint32_t HOST_CRC32 = 0 ;
-	uint8_t CRC_State ;
 	uint32_t HOST_Address = 0 ;
 	uint8_t PayLoad_Length = 0 ;
 	uint8_t Write_Verification = FLASH_WRITE_FAIL ;
 	uint8_t Address_Verification = ADDRESS_INVALID ;
 
-	/* Whole packet length (Including the first Byte ) */
-	HOST_Whole_Packet_Length = Host_Buffer[0] + 1 ;
 
-	/* Store CRC value (4 Byte) */
-	HOST_CRC32 = *(uint32_t *)(Host_Buffer + HOST_Whole_Packet_Length - CRC_TYPE_SIZE_BYTE) ;
+	Send_ACK_Reply(1) ;
+	HOST_Address   = *((uint32_t*)(&Host_Buffer[2])) ;
+	PayLoad_Length = Host_Buffer[6] ;
+	/* Check if Address is valid or not */
+	Address_Verification = HOST_Jump_Address_Verification(HOST_Address) ;
+
+	/* Payload starts at Host_Buffer[7] and has to be inside the received frame */
+	if (Frame_Payload_Check(Host_Buffer, 7, PayLoad_Length) != FRAME_PAYLOAD_OK)
+	{
+		Address_Verification = ADDRESS_INVALID ;
+	}
+
+	/* RAM is only written inside the load window , never over the bootloader own data */
+	if ((Address_Verification == ADDRESS_VALID) &&
+		(Host_Region_Verification(HOST_Address, PayLoad_Length) != ADDRESS_VALID) &&
+		(Ram_Load_Verification(HOST_Address, PayLoad_Length) != ADDRESS_VALID))
+	{
+		Address_Verification = ADDRESS_INVALID ;
+	}
 
-	/* CRC Verification */
-	CRC_State = CRC_Verify (Host_Buffer,HOST_Whole_Packet_Length-4,HOST_CRC32) ;
+	/* Record area and booting slot are owned by the bootloader */
+	if (Flash_Region_Writable(HOST_Address, HOST_Address + PayLoad_Length) != ADDRESS_VALID)
+	{
+		Address_Verification = ADDRESS_INVALID ;
+	}
 
+	/* Encrypted frames are placed by image offset , nothing before the image base */
+	if ((BL_Decrypt_Session_State == DECRYPT_SESSION_ACTIVE) && (HOST_Address < BL_Decrypt_Image_Base))
+	{
+		Address_Verification = ADDRESS_INVALID ;
+	}
 
-	if (CRC_State == CRC_OK)
+	if (Address_Verification == ADDRESS_VALID )
 	{
-		Send_ACK_Reply(1) ;
-		HOST_Address   = *((uint32_t*)(&Host_Buffer[2])) ;
-		PayLoad_Length = Host_Buffer[6] ;
-		/* Check if Address is valid or not */
-		Address_Verification = HOST_Jump_Address_Verification(HOST_Address) ;
+		App_Record_Invalidate_Range(HOST_Address, HOST_Address + PayLoad_Length) ;
 
-		if (Address_Verification == ADDRESS_VALID )
+		/* Decrypt in place , normally only a XOR with the keystream prepared after the last frame */
+		if (BL_Decrypt_Session_State == DECRYPT_SESSION_ACTIVE)
 		{
+			BL_AES_CTR_Crypt(&BL_Decrypt_Context, HOST_Address - BL_Decrypt_Image_Base, &Host_Buffer[7], PayLoad_Length) ;
+		}
 
+		if (Ram_Load_Verification(HOST_Address, PayLoad_Length) == ADDRESS_VALID)
+		{
+			Write_Verification = Ram_Memory_Write_Payload(&Host_Buffer[7],HOST_Address, PayLoad_Length) ;
+		}
+		else
+		{
 			Write_Verification = Flash_Memory_Write_Payload(&Host_Buffer[7],HOST_Address, PayLoad_Length) ;
-			if (Write_Verification == FLASH_WRITE_DONE)
+		}
+
+		if (Write_Verification == FLASH_WRITE_DONE)
+		{
+			/* Hash the frame while it is still in the buffer */
+			if (BL_Digest_Stream_State == DIGEST_STREAM_ACTIVE)
 			{
-				/* Report Writing Succeeded */
-				HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &Write_Verification,1,HAL_MAX_DELAY) ;
+				BL_SHA256_Update(&BL_Digest_Stream_Context, &Host_Buffer[7], PayLoad_Length) ;
 			}
-			else
-				/* Report Writing Failed */
-				HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &Write_Verification,1,HAL_MAX_DELAY) ;
+			Journal_Progress(HOST_Address, PayLoad_Length) ;
+			/* Report Writing Succeeded */
+			Host_Transmit(&Write_Verification, 1) ;
 		}
-
 		else
+			/* Report Writing Failed */
+			Host_Transmit(&Write_Verification, 1) ;
+
+		/*
+		 * Keystream for the frame the host will most likely send next , prepared after
+		 * the reply so it does not delay it and runs within the host turnaround. A frame
+		 * at another offset is still crypted by BL_AES_CTR_Crypt.
+		 */
+		if (BL_Decrypt_Session_State == DECRYPT_SESSION_ACTIVE)
 		{
-			/* Report Invalid Address so i can't write */
-			HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &Write_Verification,1,HAL_MAX_DELAY) ;
+			BL_AES_CTR_Prepare(&BL_Decrypt_Context, (HOST_Address + PayLoad_Length) - BL_Decrypt_Image_Base, PayLoad_Length) ;
 		}
 	}
+
 	else
 	{
-		Send_NACK() ;
+		/* Report Invalid Address so i can't write */
+		Host_Transmit(&Write_Verification, 1) ;
 	}
 
 }
@@ -517,86 +828,1647 @@ static uint8_t Change_RDP_Level (uint32_t RDP_Level )
 
 static void BL_Change_Read_Protection(uint8_t *Host_Buffer)
 {
-	uint16_t HOST_Whole_Packet_Length = 0 ;
-	uint32_t HOST_CRC32 = 0 ;
-	uint8_t CRC_State ;
 	uint8_t Change_Status = ROP_LEVEL_CHANGE_INVALID ;
 	uint8_t HOST_ROP_Level = 0 ;
 
-	/* Whole packet length (Including the first Byte ) */
-	HOST_Whole_Packet_Length = Host_Buffer[0] + 1 ;
-
-	/* Store CRC value (4 Byte) */
-	HOST_CRC32 = *(uint32_t *)(Host_Buffer + HOST_Whole_Packet_Length - CRC_TYPE_SIZE_BYTE) ;
 
-	/* CRC Verification */
-	CRC_State = CRC_Verify (Host_Buffer,HOST_Whole_Packet_Length-4,HOST_CRC32) ;
+	Send_ACK_Reply(1) ;
 
 
-	if (CRC_State == CRC_OK)
+	HOST_ROP_Level = Host_Buffer[2] ;
+	/* To make sure not to enter Level 2 */
+	if (HOST_ROP_Level != OB_RDP_LEVEL_2)
 	{
-		Send_ACK_Reply(1) ;
-
-
-		HOST_ROP_Level = Host_Buffer[2] ;
-		/* To make sure not to enter Level 2 */
-		if (HOST_ROP_Level != OB_RDP_LEVEL_2)
-		{
-		/* Request Change Read out protection Level */
-		Change_Status  = Change_RDP_Level(Host_Buffer[2]) ;
-		}
+	/* Request Change Read out protection Level */
+	Change_Status  = Change_RDP_Level(Host_Buffer[2]) ;
+	}
 
-		if (Change_Status == ROP_LEVEL_CHANGE_VALID )
-		{
-			/* Report Writing Succeeded */
-			HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &Change_Status,1,HAL_MAX_DELAY) ;
-		}
-		else
-		{
-			/* Report Invalid Address so i can't write */
-			HAL_UART_Transmit(BL_HOST_COMMUNICATION_UART, &Change_Status,1,HAL_MAX_DELAY) ;
-		}
+	if (Change_Status == ROP_LEVEL_CHANGE_VALID )
+	{
+		/* Report Writing Succeeded */
+		Host_Transmit(&Change_Status, 1) ;
 	}
 	else
 	{
-		Send_NACK() ;
+		/* Report Invalid Address so i can't write */
+		Host_Transmit(&Change_Status, 1) ;
 	}
 }
 
 
-static void Jump_To_User_App (void)
+/* CRC over the image words as the hardware computes it , trailing bytes padded with erased 0xFF */
+static uint32_t Flash_Image_CRC (uint32_t Image_Base , uint32_t Image_Length)
 {
-	/* Main Stack Pointer Value */
-	uint32_t MSP_Value  = *((volatile uint32_t *) FLASH_SECTOR2_BASE_ADDRESS) ;
-	/* Reset Handler Definition Function */
-	uint32_t MainAppAdr = *((volatile uint32_t *) FLASH_SECTOR2_BASE_ADDRESS+4) ;
-
-	/* Pointer to Function points to Reset Handler */
-	pMainApp Reset_Handler_Address  = (pMainApp) MainAppAdr ;
+	uint32_t CRC_Value ;
+	uint32_t Tail_Word = 0xFFFFFFFFU ;
+	uint32_t Whole_Words = Image_Length / 4 ;
 
-	/* Set the Value of MSP */
-	__set_MSP(MSP_Value) ;
+	CRC_Value = HAL_CRC_Calculate(&hcrc, (uint32_t *)Image_Base, Whole_Words) ;
 
-	/* Re-Initialize clock and peripherals Again */
-	HAL_RCC_DeInit() ;
+	if ((Image_Length % 4) != 0)
+	{
+		memcpy(&Tail_Word, (uint8_t *)(Image_Base + (Whole_Words * 4)), Image_Length % 4) ;
+		CRC_Value = HAL_CRC_Accumulate(&hcrc, &Tail_Word, 1) ;
+	}
 
-	/* Call Reset Handler */
-	Reset_Handler_Address () ;
+	__HAL_CRC_DR_RESET(&hcrc) ;
 
+	return CRC_Value ;
 }
 
-BL_Status BL_UART_Fetch_Host_Commands (void)
+/* Header at Image_Base , IMAGE_HEADER_NONE for a raw vector table image */
+static uint8_t Image_Header_Parse (uint32_t Image_Base , BL_Image_Header_t *Header)
 {
-	BL_Status Status = BL_NACK ;
-	/* UART RX return */
-	HAL_StatusTypeDef HAL_Status = HAL_ERROR ;
+	uint8_t Return_Status = IMAGE_HEADER_NONE ;
+	uint32_t Area_Size = Image_Area_Size(Image_Base) ;
+
+	/* Only the app areas are read , any other base may be unmapped */
+	if (Area_Size > BL_IMAGE_HEADER_SIZE)
+	{
+		memcpy(Header, (const void *)Image_Base, sizeof(BL_Image_Header_t)) ;
+	}
+
+	if ((Area_Size > BL_IMAGE_HEADER_SIZE) &&
+		(Header->Magic == BL_IMAGE_HEADER_MAGIC) && (Header->Header_Version == BL_IMAGE_HEADER_VERSION) &&
+		(Header->Image_Size <= (Area_Size - BL_IMAGE_HEADER_SIZE)) &&
+		(Header->Load_Address == (Image_Base + BL_IMAGE_HEADER_SIZE)))
+	{
+		if (HAL_CRC_Calculate(&hcrc, (uint32_t *)Header, BL_IMAGE_HEADER_CRC_WORDS) == Header->Header_CRC)
+		{
+			Return_Status = IMAGE_HEADER_VALID ;
+		}
+		__HAL_CRC_DR_RESET(&hcrc) ;
+	}
+
+	return Return_Status ;
+}
+
+/* Where the vector table of the image at Image_Base sits */
+static uint32_t Image_Vector_Base (uint32_t Image_Base)
+{
+	BL_Image_Header_t Header ;
+
+	return (Image_Header_Parse(Image_Base, &Header) == IMAGE_HEADER_VALID) ? Header.Load_Address : Image_Base ;
+}
+
+/* Initial MSP must point into RAM and the reset vector into the image itself */
+static uint8_t Vector_Table_Sanity (uint32_t Image_Base , uint32_t Image_Length)
+{
+	uint8_t Return_Status = APP_INVALID ;
+	BL_Image_Header_t Header ;
+	uint8_t Header_State = Image_Header_Parse(Image_Base, &Header) ;
+	uint32_t Vector_Base = (Header_State == IMAGE_HEADER_VALID) ? Header.Load_Address : Image_Base ;
+	uint32_t MSP_Value  = ((volatile uint32_t *) Vector_Base)[0] ;
+	uint32_t Reset_Value = ((volatile uint32_t *) Vector_Base)[1] ;
+
+	/* The header entry address has to agree with the vector table */
+	if ((Header_State == IMAGE_HEADER_VALID) && (Header.Entry_Address != Reset_Value))
+	{
+		Reset_Value = 0 ;
+	}
+
+	if ((((MSP_Value > SRAM1_BASE) && (MSP_Value <= STM32F407_SRAM2_END)) ||
+		 ((MSP_Value > CCMDATARAM_BASE) && (MSP_Value <= STM32F407_SRAM3_END))) &&
+		((MSP_Value & 0x3U) == 0) &&
+		((Reset_Value & 0x1U) != 0) &&
+		((Reset_Value & ~0x1U) >= Image_Base) && ((Reset_Value & ~0x1U) < (Image_Base + Image_Length)))
+	{
+		Return_Status = APP_VALID ;
+	}
+
+	return Return_Status ;
+}
+
+/* Append a not validated record , only if the latest one says validated */
+static void App_Record_Invalidate (uint32_t Image_Base)
+{
+	const BL_Record_t *Record = BL_Record_Find(BL_RECORD_TYPE_APP, Image_Base) ;
+	BL_App_Record_t App_Record ;
+
+	if ((Record != NULL) && (Record->Data.App.Validated == BL_APP_VALIDATED))
+	{
+		App_Record = Record->Data.App ;
+		App_Record.Validated = BL_APP_NOT_VALIDATED ;
+		BL_Record_Write(BL_RECORD_TYPE_APP, (uint32_t *)&App_Record) ;
+	}
+}
+
+/* Invalidate every image record ( sector 2 , slot A , slot B ) overlapping [Range_Start , Range_End) */
+static void App_Record_Invalidate_Range (uint32_t Range_Start , uint32_t Range_End)
+{
+	static const uint32_t Image_Bases[] = {FLASH_SECTOR2_BASE_ADDRESS, BL_SLOT_A_BASE, BL_SLOT_B_BASE} ;
+	const BL_Record_t *Record ;
+	uint8_t Image_Counter ;
+
+	for (Image_Counter = 0 ; Image_Counter < (sizeof(Image_Bases)/sizeof(Image_Bases[0])) ; Image_Counter++)
+	{
+		Record = BL_Record_Find(BL_RECORD_TYPE_APP, Image_Bases[Image_Counter]) ;
+
+		if ((Record != NULL) &&
+			(Range_Start < (Record->Data.App.Image_Base + Record->Data.App.Image_Length)) &&
+			(Range_End > Record->Data.App.Image_Base))
+		{
+			App_Record_Invalidate(Image_Bases[Image_Counter]) ;
+		}
+	}
+}
+
+/* Size of the flash area an image based at Image_Base may use , 0 if no image lives there */
+static uint32_t Image_Area_Size (uint32_t Image_Base)
+{
+	uint32_t Area_Size = 0 ;
+
+	if (Image_Base == FLASH_SECTOR2_BASE_ADDRESS)
+	{
+		Area_Size = BL_APP_AREA_END - FLASH_SECTOR2_BASE_ADDRESS ;
+	}
+	else if ((Image_Base == BL_SLOT_A_BASE) || (Image_Base == BL_SLOT_B_BASE))
+	{
+		Area_Size = BL_SLOT_SIZE ;
+	}
+
+	return Area_Size ;
+}
+
+/* Slot named by the selector record , the sector 2 image when slots were never activated */
+static uint32_t Active_Image_Base (void)
+{
+	const BL_Record_t *Selector = BL_Record_Find(BL_RECORD_TYPE_SLOT, BL_SLOT_SELECTOR_KEY) ;
+
+	return (Selector != NULL) ? Selector->Data.Slot.Active_Base : FLASH_SECTOR2_BASE_ADDRESS ;
+}
+
+/* Slot a new image is downloaded into */
+static uint32_t Inactive_Slot_Base (void)
+{
+	return (Active_Image_Base() == BL_SLOT_A_BASE) ? BL_SLOT_B_BASE : BL_SLOT_A_BASE ;
+}
+
+/* Bootloader , record area and the booting slot are never written by the host */
+static uint8_t Flash_Region_Writable (uint32_t Region_Start , uint32_t Region_End)
+{
+	uint8_t Return_Status = ADDRESS_VALID ;
+	uint32_t Active_Base = Active_Image_Base() ;
+
+	if ((Region_End > FLASH_BASE) && (Region_Start < FLASH_SECTOR2_BASE_ADDRESS))
+	{
+		/* Sectors 0 and 1 , the running bootloader */
+		Return_Status = ADDRESS_INVALID ;
+	}
+	else if ((Region_End > BL_RECORD_AREA_BASE) && (Region_Start < BL_RECORD_AREA_END))
+	{
+		Return_Status = ADDRESS_INVALID ;
+	}
+	else if ((Active_Base != FLASH_SECTOR2_BASE_ADDRESS) &&
+			 (Region_End > Active_Base) && (Region_Start < (Active_Base + BL_SLOT_SIZE)))
+	{
+		Return_Status = ADDRESS_INVALID ;
+	}
+
+	return Return_Status ;
+}
+
+/* Point the selector at a validated slot , the only write of the switch */
+static uint8_t Slot_Activate (uint32_t Slot_Base)
+{
+	uint8_t Return_Status = SLOT_ACTIVATE_FAIL ;
+	const BL_Record_t *Selector = BL_Record_Find(BL_RECORD_TYPE_SLOT, BL_SLOT_SELECTOR_KEY) ;
+	const BL_Record_t *Record = BL_Record_Find(BL_RECORD_TYPE_APP, Slot_Base) ;
+	BL_Slot_Record_t Slot_Record ;
+
+	if (((Slot_Base == BL_SLOT_A_BASE) || (Slot_Base == BL_SLOT_B_BASE)) &&
+		(Record != NULL) && (Record->Data.App.Validated == BL_APP_VALIDATED) &&
+		(Vector_Table_Sanity(Slot_Base, Record->Data.App.Image_Length) == APP_VALID))
+	{
+		Slot_Record.Key           = BL_SLOT_SELECTOR_KEY ;
+		Slot_Record.Active_Base   = Slot_Base ;
+		Slot_Record.Previous_Base = Active_Image_Base() ;
+		Slot_Record.Sequence      = (Selector != NULL) ? (Selector->Data.Slot.Sequence + 1) : 1 ;
+
+		if (Slot_Record.Previous_Base == Slot_Base)
+		{
+			Slot_Record.Previous_Base = Selector->Data.Slot.Previous_Base ;
+		}
+
+		if (BL_Record_Write(BL_RECORD_TYPE_SLOT, (uint32_t *)&Slot_Record) == RECORD_WRITE_DONE)
+		{
+			Return_Status = SLOT_ACTIVATE_DONE ;
+		}
+	}
+
+	return Return_Status ;
+}
+
+/*
+ * Record and vector table only , the whole image CRC is recalculated
+ * every BL_APP_REVERIFY_PERIOD boots counted in the record tally.
+ */
+static uint8_t Image_Validity_Check (uint32_t Image_Base)
+{
+	uint8_t Return_Status = APP_INVALID ;
+	const BL_Record_t *Record = BL_Record_Find(BL_RECORD_TYPE_APP, Image_Base) ;
+	uint8_t Full_Verify = 0 ;
+
+	if ((Record != NULL) && (Record->Data.App.Validated == BL_APP_VALIDATED))
+	{
+		Return_Status = Vector_Table_Sanity(Record->Data.App.Image_Base, Record->Data.App.Image_Length) ;
+	}
+
+#if BL_APP_REVERIFY_PERIOD != 0
+	if (Return_Status == APP_VALID)
+	{
+		if (BL_Record_Tally_Increment(Record) != RECORD_WRITE_DONE)
+		{
+			/* Tally used up : verify and start a fresh copy of the record */
+			Full_Verify = 1 ;
+			if (Flash_Image_CRC(Record->Data.App.Image_Base, Record->Data.App.Image_Length) == Record->Data.App.Image_CRC)
+			{
+				BL_Record_Write(BL_RECORD_TYPE_APP, Record->Data.Words) ;
+			}
+			else
+			{
+				Return_Status = APP_INVALID ;
+			}
+		}
+		else if ((BL_Record_Tally_Count(Record) % BL_APP_REVERIFY_PERIOD) == 0)
+		{
+			Full_Verify = 1 ;
+			if (Flash_Image_CRC(Record->Data.App.Image_Base, Record->Data.App.Image_Length) != Record->Data.App.Image_CRC)
+			{
+				Return_Status = APP_INVALID ;
+			}
+		}
+	}
+#endif
+
+	/* Do not pay for a failed full check again on every boot */
+	if ((Full_Verify == 1) && (Return_Status == APP_INVALID))
+	{
+		App_Record_Invalidate(Image_Base) ;
+	}
+
+	return Return_Status ;
+}
+
+/* Boot time decision : the active slot , else the slot it replaced */
+uint8_t BL_App_Validity_Check (void)
+{
+	uint8_t Return_Status = APP_INVALID ;
+	const BL_Record_t *Selector = BL_Record_Find(BL_RECORD_TYPE_SLOT, BL_SLOT_SELECTOR_KEY) ;
+
+	if (Selector == NULL)
+	{
+		BL_Boot_Image_Base = FLASH_SECTOR2_BASE_ADDRESS ;
+		Return_Status = Image_Validity_Check(BL_Boot_Image_Base) ;
+	}
+	else
+	{
+		BL_Boot_Image_Base = Selector->Data.Slot.Active_Base ;
+		Return_Status = Image_Validity_Check(BL_Boot_Image_Base) ;
+
+		if ((Return_Status == APP_INVALID) && (Image_Area_Size(Selector->Data.Slot.Previous_Base) != 0))
+		{
+			BL_Boot_Image_Base = Selector->Data.Slot.Previous_Base ;
+			Return_Status = Image_Validity_Check(BL_Boot_Image_Base) ;
+		}
+	}
+
+	return Return_Status ;
+}
+
+/* End of a download : host sends the image extent and CRC , the BL checks it and records it */
+static void BL_Validate_App(uint8_t *Host_Buffer)
+{
+	BL_App_Record_t App_Record ;
+	BL_Image_Header_t Header ;
+	uint8_t Validate_Status = APP_INVALID ;
+
+	Send_ACK_Reply(1) ;
+
+	App_Record.Image_Base   = *((uint32_t*)(&Host_Buffer[2])) ;
+	App_Record.Image_Length = *((uint32_t*)(&Host_Buffer[6])) ;
+	App_Record.Image_CRC    = *((uint32_t*)(&Host_Buffer[10])) ;
+	App_Record.Validated    = BL_APP_VALIDATED ;
+
+	/* A header gives the extent and CRC itself , the host values are not used . The base is checked before anything is read */
+	if ((Image_Area_Size(App_Record.Image_Base) > BL_IMAGE_HEADER_SIZE) &&
+		(Host_Region_Verification(App_Record.Image_Base, BL_IMAGE_HEADER_SIZE) == ADDRESS_VALID) &&
+		(Image_Header_Parse(App_Record.Image_Base, &Header) == IMAGE_HEADER_VALID))
+	{
+		App_Record.Image_Length = 0 ;
+		if (Flash_Image_CRC(Header.Load_Address, Header.Image_Size) == Header.Image_CRC)
+		{
+			App_Record.Image_Length = BL_IMAGE_HEADER_SIZE + Header.Image_Size ;
+			App_Record.Image_CRC    = Flash_Image_CRC(App_Record.Image_Base, App_Record.Image_Length) ;
+		}
+	}
+
+	if ((App_Record.Image_Length >= 8) &&
+		(App_Record.Image_Length <= Image_Area_Size(App_Record.Image_Base)) &&
+		(Vector_Table_Sanity(App_Record.Image_Base, App_Record.Image_Length) == APP_VALID) &&
+		(Flash_Image_CRC(App_Record.Image_Base, App_Record.Image_Length) == App_Record.Image_CRC))
+	{
+		if (BL_Record_Write(BL_RECORD_TYPE_APP, (uint32_t *)&App_Record) == RECORD_WRITE_DONE)
+		{
+			Validate_Status = APP_VALID ;
+		}
+	}
+
+	/* Report Validation Status */
+	Host_Transmit(&Validate_Status, 1) ;
+}
+
+/* DWT cycle counter , left running once enabled */
+static void Cycle_Counter_Enable (void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk ;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk ;
+}
+
+/* Whole region must be inside flash */
+static uint8_t Host_Region_Verification (uint32_t Region_Base , uint32_t Region_Length)
+{
+	uint8_t Return_Status = ADDRESS_INVALID ;
+
+	if ((Region_Base >= FLASH_BASE) && (Region_Base < STM32F407_FLASH_END) &&
+		(Region_Length <= (STM32F407_FLASH_END - Region_Base)))
+	{
+		Return_Status = ADDRESS_VALID ;
+	}
+
+	return Return_Status ;
+}
+
+/*
+ * Payload_Length bytes after Header_Length bytes of frame must end before the CRC.
+ * The frame is never cleared , so bytes past the received length are left over
+ * from an older frame.
+ */
+static uint8_t Frame_Payload_Check (uint8_t *Host_Buffer , uint8_t Header_Length , uint8_t Payload_Length)
+{
+	uint8_t Return_Status = FRAME_PAYLOAD_SHORT ;
+
+	if ((uint16_t)(Header_Length + Payload_Length + CRC_TYPE_SIZE_BYTE) <= (uint16_t)(Host_Buffer[0] + 1))
+	{
+		Return_Status = FRAME_PAYLOAD_OK ;
+	}
+
+	return Return_Status ;
+}
+
+/* SHA-256 of a flash region , or of every frame written since the stream was started */
+static void BL_Image_Digest(uint8_t *Host_Buffer)
+{
+	uint8_t Digest_Mode ;
+	uint32_t Region_Base ;
+	uint32_t Region_Length ;
+	uint8_t Digest[BL_SHA256_DIGEST_SIZE] ;
+	uint8_t Digest_Status = DIGEST_FAIL ;
+
+	Digest_Mode = Host_Buffer[2] ;
+
+	if (Digest_Mode == BL_DIGEST_REGION)
+	{
+		Region_Base   = *((uint32_t*)(&Host_Buffer[3])) ;
+		Region_Length = *((uint32_t*)(&Host_Buffer[7])) ;
+
+		if (Host_Region_Verification(Region_Base, Region_Length) == ADDRESS_VALID)
+		{
+			BL_SHA256_Init(&BL_Digest_Region_Context) ;
+			BL_SHA256_Update(&BL_Digest_Region_Context, (const uint8_t *)Region_Base, Region_Length) ;
+			BL_SHA256_Final(&BL_Digest_Region_Context, Digest) ;
+			Send_ACK_Reply(BL_SHA256_DIGEST_SIZE) ;
+			Host_Transmit(Digest, BL_SHA256_DIGEST_SIZE) ;
+		}
+		else
+		{
+			Send_ACK_Reply(1) ;
+			Host_Transmit(&Digest_Status, 1) ;
+		}
+	}
+	else if (Digest_Mode == BL_DIGEST_STREAM_START)
+	{
+		BL_SHA256_Init(&BL_Digest_Stream_Context) ;
+		BL_Digest_Stream_State = DIGEST_STREAM_ACTIVE ;
+		Digest_Status = DIGEST_DONE ;
+		Send_ACK_Reply(1) ;
+		Host_Transmit(&Digest_Status, 1) ;
+	}
+	else if ((Digest_Mode == BL_DIGEST_STREAM_FINISH) && (BL_Digest_Stream_State == DIGEST_STREAM_ACTIVE))
+	{
+		BL_SHA256_Final(&BL_Digest_Stream_Context, Digest) ;
+		BL_Digest_Stream_State = DIGEST_STREAM_IDLE ;
+		Send_ACK_Reply(BL_SHA256_DIGEST_SIZE) ;
+		Host_Transmit(Digest, BL_SHA256_DIGEST_SIZE) ;
+	}
+	else
+	{
+		Send_ACK_Reply(1) ;
+		Host_Transmit(&Digest_Status, 1) ;
+	}
+}
+
+/* Hash Length bytes of flash from FLASH_BASE and report the cost in DWT cycles */
+static void BL_Digest_Bench(uint8_t *Host_Buffer)
+{
+	uint32_t Bench_Length ;
+	uint32_t Bench_Report[3] = {0} ;
+	uint8_t Digest[BL_SHA256_DIGEST_SIZE] ;
+	uint32_t Start_Cycles ;
+
+	Bench_Length = *((uint32_t*)(&Host_Buffer[2])) ;
+	if (Bench_Length > STM32F407_FLASH_SIZE)
+	{
+		Bench_Length = STM32F407_FLASH_SIZE ;
+	}
+
+	Cycle_Counter_Enable() ;
+
+	Start_Cycles = DWT->CYCCNT ;
+	BL_SHA256_Init(&BL_Digest_Region_Context) ;
+	BL_SHA256_Update(&BL_Digest_Region_Context, (const uint8_t *)FLASH_BASE, Bench_Length) ;
+	BL_SHA256_Final(&BL_Digest_Region_Context, Digest) ;
+
+	/* Cycles , Bytes , Cycles per byte x100 */
+	Bench_Report[0] = DWT->CYCCNT - Start_Cycles ;
+	Bench_Report[1] = Bench_Length ;
+	if (Bench_Length != 0)
+	{
+		Bench_Report[2] = (uint32_t)(((uint64_t)Bench_Report[0] * 100U) / Bench_Length) ;
+	}
+
+	Send_ACK_Reply(sizeof(Bench_Report)) ;
+	Host_Transmit((uint8_t *)Bench_Report, sizeof(Bench_Report)) ;
+}
+
+/* Start ( Image_Base + Nonce ) or stop the decryption of BL_Memory_Write payloads */
+static void BL_Decrypt_Session(uint8_t *Host_Buffer)
+{
+	uint8_t Session_Status = DECRYPT_SESSION_FAIL ;
+
+	Send_ACK_Reply(1) ;
+
+	if (Host_Buffer[2] == BL_DECRYPT_SESSION_START)
+	{
+		BL_Decrypt_Image_Base = *((uint32_t*)(&Host_Buffer[3])) ;
+		if (HOST_Jump_Address_Verification(BL_Decrypt_Image_Base) == ADDRESS_VALID)
+		{
+			/* Nonce is Host_Buffer[7] -> [22] */
+			BL_AES_Init(&BL_Decrypt_Context, BL_AES_Key, &Host_Buffer[7]) ;
+			/* First frame is usually the image start */
+			BL_AES_CTR_Prepare(&BL_Decrypt_Context, 0, BL_AES_KEYSTREAM_SIZE - BL_AES_BLOCK_SIZE) ;
+			BL_Decrypt_Session_State = DECRYPT_SESSION_ACTIVE ;
+			Session_Status = DECRYPT_SESSION_DONE ;
+		}
+	}
+	else if (Host_Buffer[2] == BL_DECRYPT_SESSION_STOP)
+	{
+		BL_Decrypt_Session_State = DECRYPT_SESSION_IDLE ;
+		Session_Status = DECRYPT_SESSION_DONE ;
+	}
+
+	Host_Transmit(&Session_Status, 1) ;
+}
+
+/*
+ * Decrypt Length bytes ( in frame sized pieces , keystream generated on the fly )
+ * and compare the throughput with what the host link can deliver.
+ */
+static void BL_Decrypt_Bench(uint8_t *Host_Buffer)
+{
+	uint32_t Bench_Length ;
+	uint32_t Bench_Offset ;
+	uint32_t Piece_Length ;
+	uint8_t  Bench_Key[BL_AES_KEY_SIZE] = {0} ;
+	uint8_t  Bench_Nonce[BL_AES_BLOCK_SIZE] = {0} ;
+	/* Own context and key , an open decrypt session is left as it is */
+	BL_AES_Context_t Bench_Context ;
+	/* Cycles , Bytes , Decrypt Bytes/s , Link Bytes/s , Keeps Up */
+	uint32_t Bench_Report[5] = {0} ;
+	uint32_t Start_Cycles ;
+
+	Bench_Length = *((uint32_t*)(&Host_Buffer[2])) ;
+	if (Bench_Length > STM32F407_FLASH_SIZE)
+	{
+		Bench_Length = STM32F407_FLASH_SIZE ;
+	}
+
+	BL_AES_Init(&Bench_Context, Bench_Key, Bench_Nonce) ;
+
+	Cycle_Counter_Enable() ;
+
+	Start_Cycles = DWT->CYCCNT ;
+	for (Bench_Offset = 0 ; Bench_Offset < Bench_Length ; Bench_Offset += Piece_Length)
+	{
+		Piece_Length = Bench_Length - Bench_Offset ;
+		if (Piece_Length > BL_HOST_BUFFER_RX_LENGTH)
+		{
+			Piece_Length = BL_HOST_BUFFER_RX_LENGTH ;
+		}
+		BL_AES_CTR_Crypt(&Bench_Context, Bench_Offset, BL_Bench_Buffer, Piece_Length) ;
+	}
+	Bench_Report[0] = DWT->CYCCNT - Start_Cycles ;
+	Bench_Report[1] = Bench_Length ;
+	if (Bench_Report[0] != 0)
+	{
+		Bench_Report[2] = (uint32_t)(((uint64_t)Bench_Length * SystemCoreClock) / Bench_Report[0]) ;
+	}
+	/* 8N1 : 10 bits on the wire per byte */
+	Bench_Report[3] = (BL_HOST_COMMUNICATION_UART)->Init.BaudRate / 10 ;
+	Bench_Report[4] = (Bench_Report[2] >= Bench_Report[3]) ? 1 : 0 ;
+
+	Send_ACK_Reply(sizeof(Bench_Report)) ;
+	Host_Transmit((uint8_t *)Bench_Report, sizeof(Bench_Report)) ;
+}
+
+/* Output of the LZ decoder goes straight into the write combiner */
+static uint8_t LZ_Output_To_Flash (uint8_t Byte)
+{
+	return (Write_Combiner_Put(Byte) == FLASH_WRITE_DONE) ? LZ_DECODE_OK : LZ_DECODE_FAIL ;
+}
+
+/* Start ( Destination + Output Length ) or finish a compressed download */
+static void BL_LZ_Session(uint8_t *Host_Buffer)
+{
+	uint32_t Destination ;
+	uint32_t Output_Length ;
+	/* Status , Decoded Length */
+	uint8_t Session_Report[5] = {FLASH_WRITE_FAIL} ;
+
+	if (Host_Buffer[2] == BL_LZ_SESSION_START)
+	{
+		Destination   = *((uint32_t*)(&Host_Buffer[3])) ;
+		Output_Length = *((uint32_t*)(&Host_Buffer[7])) ;
+
+		/* Flash only , never the record area or the booting slot */
+		if ((Host_Region_Verification(Destination, Output_Length) == ADDRESS_VALID) &&
+			(Flash_Region_Writable(Destination, Destination + Output_Length) == ADDRESS_VALID))
+		{
+			App_Record_Invalidate_Range(Destination, Destination + Output_Length) ;
+			BL_LZ_Init(&BL_LZ_Context) ;
+			Write_Combiner_Start(Destination, Destination + Output_Length) ;
+			BL_LZ_Session_State = LZ_SESSION_ACTIVE ;
+			Session_Report[0] = FLASH_WRITE_DONE ;
+		}
+		Send_ACK_Reply(1) ;
+		Host_Transmit(Session_Report, 1) ;
+	}
+	else
+	{
+		if (BL_LZ_Session_State == LZ_SESSION_ACTIVE)
+		{
+			Session_Report[0] = Write_Combiner_Flush() ;
+			memcpy(&Session_Report[1], &BL_LZ_Context.Output_Length, 4) ;
+		}
+		BL_LZ_Session_State = LZ_SESSION_IDLE ;
+		Send_ACK_Reply(sizeof(Session_Report)) ;
+		Host_Transmit(Session_Report, sizeof(Session_Report)) ;
+	}
+}
+
+/* Compressed frame : decoded straight into flash at the session write position */
+static void BL_Memory_Write_LZ(uint8_t *Host_Buffer)
+{
+	uint8_t PayLoad_Length = 0 ;
+	uint8_t Write_Verification = FLASH_WRITE_FAIL ;
+
+	Send_ACK_Reply(1) ;
+	PayLoad_Length = Host_Buffer[2] ;
+
+	/* A short frame is refused before the decoder sees it , the session stays usable */
+	if ((BL_LZ_Session_State == LZ_SESSION_ACTIVE) && (Frame_Payload_Check(Host_Buffer, 3, PayLoad_Length) == FRAME_PAYLOAD_OK))
+	{
+		if (HAL_FLASH_Unlock() == HAL_OK)
+		{
+			if (BL_LZ_Decode(&BL_LZ_Context, &Host_Buffer[3], PayLoad_Length, LZ_Output_To_Flash) == LZ_DECODE_OK)
+			{
+				Write_Verification = FLASH_WRITE_DONE ;
+			}
+		}
+		HAL_FLASH_Lock() ;
+
+		/* A broken stream can not be resumed , the host has to start again */
+		if (Write_Verification != FLASH_WRITE_DONE)
+		{
+			BL_LZ_Session_State = LZ_SESSION_IDLE ;
+		}
+	}
+
+	Host_Transmit(&Write_Verification, 1) ;
+}
+
+static uint8_t Delta_Output_To_Flash (uint8_t Byte)
+{
+	return (Write_Combiner_Put(Byte) == FLASH_WRITE_DONE) ? DELTA_APPLY_OK : DELTA_APPLY_FAIL ;
+}
+
+static uint8_t Flash_Sector_Number (uint32_t Address)
+{
+	uint8_t Sector_Number = 0 ;
+
+	while ((Sector_Number < (FLASH_SECTOR_TOTAL - 1)) && (Address >= BL_Flash_Sector_Address[Sector_Number + 1]))
+	{
+		Sector_Number++ ;
+	}
+
+	return Sector_Number ;
+}
+
+/* Erase every sector touched by [Address , Address+Length) */
+static uint8_t Flash_Erase_Range (uint32_t Address , uint32_t Length)
+{
+	uint8_t First_Sector ;
+	uint8_t Last_Sector ;
+	uint8_t Erase_Status = ERASE_VALID ;
+
+	if (Length != 0)
+	{
+		First_Sector = Flash_Sector_Number(Address) ;
+		Last_Sector  = Flash_Sector_Number(Address + Length - 1) ;
+		Erase_Status = Perform_Flash_Erase(First_Sector, (Last_Sector - First_Sector) + 1) ;
+	}
+
+	return Erase_Status ;
+}
+
+/*
+ * Start : Old_Length , Old_CRC , New_Length , New_CRC  ( booting image must match )
+ * Finish : check the image rebuilt in the inactive slot and activate it
+ */
+static void BL_Delta_Session(uint8_t *Host_Buffer)
+{
+	uint32_t Old_Length ;
+	uint32_t Old_CRC ;
+	uint32_t Old_Base ;
+	uint8_t Session_Status = APP_INVALID ;
+	BL_App_Record_t New_Record ;
+
+	Send_ACK_Reply(1) ;
+
+	if (Host_Buffer[2] == BL_DELTA_SESSION_START)
+	{
+		Old_Length          = *((uint32_t*)(&Host_Buffer[3])) ;
+		Old_CRC             = *((uint32_t*)(&Host_Buffer[7])) ;
+		BL_Delta_New_Length = *((uint32_t*)(&Host_Buffer[11])) ;
+		BL_Delta_New_CRC    = *((uint32_t*)(&Host_Buffer[15])) ;
+		BL_Delta_Session_State = DELTA_SESSION_IDLE ;
+		Old_Base             = Active_Image_Base() ;
+		BL_Delta_Target_Base = Inactive_Slot_Base() ;
+
+		if ((Old_Length <= Image_Area_Size(Old_Base)) &&
+			(BL_Delta_New_Length <= BL_SLOT_SIZE) &&
+			(Flash_Image_CRC(Old_Base, Old_Length) == Old_CRC))
+		{
+			if (Flash_Erase_Range(BL_Delta_Target_Base, BL_Delta_New_Length) == ERASE_VALID)
+			{
+				BL_Delta_Init(&BL_Delta_Context, (const uint8_t *)Old_Base, Old_Length) ;
+				Write_Combiner_Start(BL_Delta_Target_Base, BL_Delta_Target_Base + BL_Delta_New_Length) ;
+				BL_Delta_Session_State = DELTA_SESSION_ACTIVE ;
+				Session_Status = APP_VALID ;
+			}
+		}
+	}
+	else if ((Host_Buffer[2] == BL_DELTA_SESSION_FINISH) && (BL_Delta_Session_State == DELTA_SESSION_ACTIVE))
+	{
+		BL_Delta_Session_State = DELTA_SESSION_IDLE ;
+
+		New_Record.Image_Base   = BL_Delta_Target_Base ;
+		New_Record.Image_Length = BL_Delta_New_Length ;
+		New_Record.Image_CRC    = BL_Delta_New_CRC ;
+		New_Record.Validated    = BL_APP_VALIDATED ;
+
+		if ((Write_Combiner_Flush() == FLASH_WRITE_DONE) &&
+			(BL_Delta_Context.Output_Length == BL_Delta_New_Length) &&
+			(Flash_Image_CRC(BL_Delta_Target_Base, BL_Delta_New_Length) == BL_Delta_New_CRC) &&
+			(BL_Record_Write(BL_RECORD_TYPE_APP, (uint32_t *)&New_Record) == RECORD_WRITE_DONE) &&
+			(Slot_Activate(BL_Delta_Target_Base) == SLOT_ACTIVATE_DONE))
+		{
+			Session_Status = APP_VALID ;
+		}
+	}
+
+	Host_Transmit(&Session_Status, 1) ;
+}
+
+/* Patch frame : applied against the booting image , output goes to the inactive slot */
+static void BL_Delta_Data(uint8_t *Host_Buffer)
+{
+	uint8_t PayLoad_Length = 0 ;
+	uint8_t Write_Verification = FLASH_WRITE_FAIL ;
+
+	Send_ACK_Reply(1) ;
+	PayLoad_Length = Host_Buffer[2] ;
+
+	if ((BL_Delta_Session_State == DELTA_SESSION_ACTIVE) && (Frame_Payload_Check(Host_Buffer, 3, PayLoad_Length) == FRAME_PAYLOAD_OK))
+	{
+		if (HAL_FLASH_Unlock() == HAL_OK)
+		{
+			if (BL_Delta_Apply(&BL_Delta_Context, &Host_Buffer[3], PayLoad_Length, Delta_Output_To_Flash) == DELTA_APPLY_OK)
+			{
+				Write_Verification = FLASH_WRITE_DONE ;
+			}
+		}
+		HAL_FLASH_Lock() ;
+
+		if (Write_Verification != FLASH_WRITE_DONE)
+		{
+			BL_Delta_Session_State = DELTA_SESSION_IDLE ;
+		}
+	}
+
+	Host_Transmit(&Write_Verification, 1) ;
+}
+
+/* Active slot , selector sequence and the record of every image area */
+static void BL_Get_Slot_Info(uint8_t *Host_Buffer)
+{
+	static const uint32_t Image_Bases[] = {FLASH_SECTOR2_BASE_ADDRESS, BL_SLOT_A_BASE, BL_SLOT_B_BASE} ;
+	const BL_Record_t *Selector ;
+	const BL_Record_t *Record ;
+	/* Active Base , Previous Base , Sequence , then Base , Length , CRC , Validated per image */
+	uint32_t Slot_Report[3 + (3*4)] = {0} ;
+	uint8_t Image_Counter ;
+
+	Selector = BL_Record_Find(BL_RECORD_TYPE_SLOT, BL_SLOT_SELECTOR_KEY) ;
+	Slot_Report[0] = Active_Image_Base() ;
+	if (Selector != NULL)
+	{
+		Slot_Report[1] = Selector->Data.Slot.Previous_Base ;
+		Slot_Report[2] = Selector->Data.Slot.Sequence ;
+	}
+
+	for (Image_Counter = 0 ; Image_Counter < 3 ; Image_Counter++)
+	{
+		Record = BL_Record_Find(BL_RECORD_TYPE_APP, Image_Bases[Image_Counter]) ;
+		if (Record != NULL)
+		{
+			memcpy(&Slot_Report[3 + (Image_Counter*4)], Record->Data.Words, 16) ;
+		}
+	}
+
+	Send_ACK_Reply(sizeof(Slot_Report)) ;
+	Host_Transmit((uint8_t *)Slot_Report, sizeof(Slot_Report)) ;
+}
+
+/* Slot Base : the slot must hold a validated image */
+static void BL_Activate_Slot(uint8_t *Host_Buffer)
+{
+	uint8_t Activate_Status = SLOT_ACTIVATE_FAIL ;
+
+	Send_ACK_Reply(1) ;
+	Activate_Status = Slot_Activate(*((uint32_t*)(&Host_Buffer[2]))) ;
+	Host_Transmit(&Activate_Status, 1) ;
+}
+
+/*
+ * Image Base ( 0 : booting image ) : header fields , or what the record knows of a raw image ,
+ * plus the sectors the image spans so the host erases only those
+ */
+static void BL_Get_Image_Info(uint8_t *Host_Buffer)
+{
+	uint32_t Image_Base ;
+	BL_Image_Header_t Header ;
+	const BL_Record_t *Record ;
+	/* Header Present , Header Version , Image Size , Load Address , Entry Address , Image CRC , App Version , First Sector , Last Sector */
+	uint32_t Image_Report[9] = {0} ;
+	uint32_t Image_Extent = 0 ;
+
+	Image_Base = *((uint32_t*)(&Host_Buffer[2])) ;
+	if (Image_Base == 0)
+	{
+		Image_Base = Active_Image_Base() ;
+	}
+
+	if (Image_Area_Size(Image_Base) != 0)
+	{
+		if (Image_Header_Parse(Image_Base, &Header) == IMAGE_HEADER_VALID)
+		{
+			Image_Report[0] = IMAGE_HEADER_VALID ;
+			memcpy(&Image_Report[1], &Header.Header_Version, 6*4) ;
+			Image_Extent = BL_IMAGE_HEADER_SIZE + Header.Image_Size ;
+		}
+		else
+		{
+			Record = BL_Record_Find(BL_RECORD_TYPE_APP, Image_Base) ;
+			if (Record != NULL)
+			{
+				Image_Report[2] = Record->Data.App.Image_Length ;
+				Image_Report[5] = Record->Data.App.Image_CRC ;
+				Image_Extent    = Record->Data.App.Image_Length ;
+			}
+			Image_Report[3] = Image_Base ;
+			Image_Report[4] = ((volatile uint32_t *) Image_Base)[1] ;
+		}
+		Image_Report[7] = Flash_Sector_Number(Image_Base) ;
+		Image_Report[8] = Flash_Sector_Number(Image_Base + ((Image_Extent != 0) ? (Image_Extent - 1) : 0)) ;
+	}
+
+	Send_ACK_Reply(sizeof(Image_Report)) ;
+	Host_Transmit((uint8_t *)Image_Report, sizeof(Image_Report)) ;
+}
+
+/* Address , Length , 32 bit Pattern : constant region programmed on the device */
+static void BL_Memory_Fill(uint8_t *Host_Buffer)
+{
+	uint32_t Fill_Address ;
+	uint32_t Fill_Length ;
+	uint32_t Pattern ;
+	uint32_t Digest_Block[BL_SHA256_BLOCK_SIZE/4] ;
+	uint32_t Hashed ;
+	uint32_t Chunk ;
+	uint32_t Rotation ;
+	uint8_t Write_Verification = FLASH_WRITE_FAIL ;
+
+	Send_ACK_Reply(1) ;
+	Fill_Address = *((uint32_t*)(&Host_Buffer[2])) ;
+	Fill_Length  = *((uint32_t*)(&Host_Buffer[6])) ;
+	Pattern      = *((uint32_t*)(&Host_Buffer[10])) ;
+
+	if ((Host_Region_Verification(Fill_Address, Fill_Length) == ADDRESS_VALID) &&
+		(Flash_Region_Writable(Fill_Address, Fill_Address + Fill_Length) == ADDRESS_VALID))
+	{
+		App_Record_Invalidate_Range(Fill_Address, Fill_Address + Fill_Length) ;
+		Write_Verification = Flash_Memory_Fill(Fill_Address, Fill_Length, Pattern) ;
+		if (Write_Verification == FLASH_WRITE_DONE)
+		{
+			Journal_Progress(Fill_Address, Fill_Length) ;
+		}
+
+		/* The filled bytes are part of the streamed image too */
+		if ((Write_Verification == FLASH_WRITE_DONE) && (BL_Digest_Stream_State == DIGEST_STREAM_ACTIVE))
+		{
+			/* Pattern rotated so the block starts with the byte at Fill_Address */
+			Rotation = (Fill_Address & 0x3U) * 8 ;
+			for (Hashed = 0 ; Hashed < (BL_SHA256_BLOCK_SIZE/4) ; Hashed++)
+			{
+				Digest_Block[Hashed] = (Rotation == 0) ? Pattern : ((Pattern >> Rotation) | (Pattern << (32 - Rotation))) ;
+			}
+			for (Hashed = 0 ; Hashed < Fill_Length ; Hashed += Chunk)
+			{
+				Chunk = ((Fill_Length - Hashed) > BL_SHA256_BLOCK_SIZE) ? BL_SHA256_BLOCK_SIZE : (Fill_Length - Hashed) ;
+				BL_SHA256_Update(&BL_Digest_Stream_Context, (uint8_t *)Digest_Block, Chunk) ;
+			}
+		}
+	}
+
+	Host_Transmit(&Write_Verification, 1) ;
+}
+
+/*
+ * Record Count , then Address (4) , Length (1) , Data per record. Every record is
+ * checked before anything is written , then they are programmed in address order.
+ */
+static void BL_Memory_Write_Scatter(uint8_t *Host_Buffer)
+{
+	uint8_t Record_Count ;
+	uint8_t Record_Offset[BL_SCATTER_MAX_RECORDS] ;
+	uint8_t Record_Counter ;
+	uint8_t Sort_Counter ;
+	uint8_t Offset_Hold ;
+	uint16_t Offset = 3 ;
+	uint16_t Payload_End ;
+	uint32_t Record_Address ;
+	uint8_t Record_Length ;
+	uint8_t Address_Verification = ADDRESS_VALID ;
+	uint8_t Write_Verification = FLASH_WRITE_FAIL ;
+
+	Send_ACK_Reply(1) ;
+	Record_Count = Host_Buffer[2] ;
+	Payload_End  = Host_Buffer[0] + 1 - CRC_TYPE_SIZE_BYTE ;
+
+	if ((Record_Count == 0) || (Record_Count > BL_SCATTER_MAX_RECORDS))
+	{
+		Address_Verification = ADDRESS_INVALID ;
+	}
+
+	/* Walk the records , each one has to lie inside the frame and in writable flash */
+	for (Record_Counter = 0 ; (Record_Counter < Record_Count) && (Address_Verification == ADDRESS_VALID) ; Record_Counter++)
+	{
+		if ((Offset + BL_SCATTER_RECORD_HEADER) > Payload_End)
+		{
+			Address_Verification = ADDRESS_INVALID ;
+			break ;
+		}
+		Record_Address = *((uint32_t*)(&Host_Buffer[Offset])) ;
+		Record_Length  = Host_Buffer[Offset + 4] ;
+
+		if (((Offset + BL_SCATTER_RECORD_HEADER + Record_Length) > Payload_End) ||
+			(Host_Region_Verification(Record_Address, Record_Length) != ADDRESS_VALID) ||
+			(Flash_Region_Writable(Record_Address, Record_Address + Record_Length) != ADDRESS_VALID) ||
+			((BL_Decrypt_Session_State == DECRYPT_SESSION_ACTIVE) && (Record_Address < BL_Decrypt_Image_Base)))
+		{
+			Address_Verification = ADDRESS_INVALID ;
+		}
+
+		/* Insertion sort of the record offsets by address */
+		Sort_Counter = Record_Counter ;
+		while ((Sort_Counter > 0) && (*((uint32_t*)(&Host_Buffer[Record_Offset[Sort_Counter - 1]])) > Record_Address))
+		{
+			Record_Offset[Sort_Counter] = Record_Offset[Sort_Counter - 1] ;
+			Sort_Counter-- ;
+		}
+		Record_Offset[Sort_Counter] = (uint8_t)Offset ;
+
+		Offset += BL_SCATTER_RECORD_HEADER + Record_Length ;
+	}
+
+	/* Overlapping records would program the same bytes twice */
+	for (Record_Counter = 1 ; (Record_Counter < Record_Count) && (Address_Verification == ADDRESS_VALID) ; Record_Counter++)
+	{
+		Offset_Hold = Record_Offset[Record_Counter - 1] ;
+		if ((*((uint32_t*)(&Host_Buffer[Offset_Hold])) + Host_Buffer[Offset_Hold + 4]) > *((uint32_t*)(&Host_Buffer[Record_Offset[Record_Counter]])))
+		{
+			Address_Verification = ADDRESS_INVALID ;
+		}
+	}
+
+	if (Address_Verification == ADDRESS_VALID)
+	{
+		Write_Verification = FLASH_WRITE_DONE ;
+		for (Record_Counter = 0 ; (Record_Counter < Record_Count) && (Write_Verification == FLASH_WRITE_DONE) ; Record_Counter++)
+		{
+			Offset         = Record_Offset[Record_Counter] ;
+			Record_Address = *((uint32_t*)(&Host_Buffer[Offset])) ;
+			Record_Length  = Host_Buffer[Offset + 4] ;
+			Offset        += BL_SCATTER_RECORD_HEADER ;
+
+			App_Record_Invalidate_Range(Record_Address, Record_Address + Record_Length) ;
+			if (BL_Decrypt_Session_State == DECRYPT_SESSION_ACTIVE)
+			{
+				BL_AES_CTR_Crypt(&BL_Decrypt_Context, Record_Address - BL_Decrypt_Image_Base, &Host_Buffer[Offset], Record_Length) ;
+			}
+			Write_Verification = Flash_Memory_Write_Payload(&Host_Buffer[Offset], Record_Address, Record_Length) ;
+			if ((Write_Verification == FLASH_WRITE_DONE) && (BL_Digest_Stream_State == DIGEST_STREAM_ACTIVE))
+			{
+				BL_SHA256_Update(&BL_Digest_Stream_Context, &Host_Buffer[Offset], Record_Length) ;
+			}
+			if (Write_Verification == FLASH_WRITE_DONE)
+			{
+				Journal_Progress(Record_Address, Record_Length) ;
+			}
+		}
+	}
+
+	Host_Transmit(&Write_Verification, 1) ;
+}
+
+/*
+ * Destination starts on a sector boundary , every destination sector is erased when
+ * the copy first reaches it. Data goes through a RAM bounce buffer so the program
+ * loop never reads the flash it is programming.
+ */
+static uint8_t Flash_Copy (uint32_t Source , uint32_t Destination , uint32_t Length)
+{
+	static uint8_t Copy_Buffer[BL_FLASH_COPY_CHUNK] BL_CCMRAM ;
+	uint8_t Return_Status = FLASH_WRITE_DONE ;
+	uint32_t Copied = 0 ;
+	uint32_t Chunk ;
+	uint8_t Erased_Sector = FLASH_SECTOR_TOTAL ;
+	uint8_t Sector_Number ;
+
+	while ((Copied < Length) && (Return_Status == FLASH_WRITE_DONE))
+	{
+		Chunk = Length - Copied ;
+		if (Chunk > BL_FLASH_COPY_CHUNK)
+		{
+			Chunk = BL_FLASH_COPY_CHUNK ;
+		}
+
+		/* Chunks never straddle a sector end , sector sizes are multiples of the chunk */
+		Sector_Number = Flash_Sector_Number(Destination + Copied) ;
+		if (Sector_Number != Erased_Sector)
+		{
+			if (Perform_Flash_Erase(Sector_Number, 1) != ERASE_VALID)
+			{
+				Return_Status = FLASH_WRITE_FAIL ;
+				break ;
+			}
+			Erased_Sector = Sector_Number ;
+		}
+
+		memcpy(Copy_Buffer, (const uint8_t *)(Source + Copied), Chunk) ;
+		Return_Status = Flash_Memory_Write_Payload(Copy_Buffer, Destination + Copied, Chunk) ;
+		Copied += Chunk ;
+	}
+
+	return Return_Status ;
+}
+
+/* Source , Destination , Length : copy inside flash , checked with the hardware CRC */
+static void BL_Flash_Copy(uint8_t *Host_Buffer)
+{
+	uint32_t Source ;
+	uint32_t Destination ;
+	uint32_t Length ;
+	uint32_t Erase_End = 0 ;
+	uint32_t Source_CRC ;
+	/* Status , CRC of the copy */
+	uint8_t Copy_Report[5] = {FLASH_WRITE_FAIL} ;
+
+	Send_ACK_Reply(sizeof(Copy_Report)) ;
+	Source      = *((uint32_t*)(&Host_Buffer[2])) ;
+	Destination = *((uint32_t*)(&Host_Buffer[6])) ;
+	Length      = *((uint32_t*)(&Host_Buffer[10])) ;
+
+	/* Every destination sector is erased whole , up to the end of the last one */
+	if ((Length != 0) && (Host_Region_Verification(Destination, Length) == ADDRESS_VALID))
+	{
+		Erase_End = BL_Flash_Sector_Address[Flash_Sector_Number(Destination + Length - 1) + 1] ;
+	}
+
+	/* Sector aligned writable destination , the source stays clear of the erased sectors */
+	if ((Erase_End != 0) &&
+		(Host_Region_Verification(Source, Length) == ADDRESS_VALID) &&
+		(Destination == BL_Flash_Sector_Address[Flash_Sector_Number(Destination)]) &&
+		(Flash_Region_Writable(Destination, Erase_End) == ADDRESS_VALID) &&
+		(((Source + Length) <= Destination) || (Erase_End <= Source)))
+	{
+		Source_CRC = Flash_Image_CRC(Source, Length) ;
+		if ((Flash_Copy(Source, Destination, Length) == FLASH_WRITE_DONE) &&
+			(Flash_Image_CRC(Destination, Length) == Source_CRC))
+		{
+			Copy_Report[0] = FLASH_WRITE_DONE ;
+		}
+		memcpy(&Copy_Report[1], &Source_CRC, 4) ;
+	}
+
+	Host_Transmit(Copy_Report, sizeof(Copy_Report)) ;
+}
+
+/*
+ * Written data extending the contiguous prefix of the journaled image moves the
+ * committed offset , a record is appended every granule and at the image end.
+ */
+static void Journal_Progress (uint32_t Address , uint32_t Length)
+{
+	uint32_t Image_Base = BL_Journal_Record.Image_Base ;
+
+	if ((BL_Journal_State == JOURNAL_ACTIVE) &&
+		(Address >= Image_Base) && (Address <= (Image_Base + BL_Journal_Record.Committed_Offset)) &&
+		((Address + Length) > (Image_Base + BL_Journal_Record.Committed_Offset)))
+	{
+		BL_Journal_Record.Committed_Offset = (Address + Length) - Image_Base ;
+		if (BL_Journal_Record.Committed_Offset > BL_Journal_Record.Image_Length)
+		{
+			BL_Journal_Record.Committed_Offset = BL_Journal_Record.Image_Length ;
+		}
+
+		if (((BL_Journal_Record.Committed_Offset - BL_Journal_Persisted) >= BL_JOURNAL_GRANULE) ||
+			(BL_Journal_Record.Committed_Offset == BL_Journal_Record.Image_Length))
+		{
+			if (BL_Record_Write(BL_RECORD_TYPE_JOURNAL, (uint32_t *)&BL_Journal_Record) == RECORD_WRITE_DONE)
+			{
+				BL_Journal_Persisted = BL_Journal_Record.Committed_Offset ;
+			}
+		}
+	}
+}
+
+/* An erase below the committed offset of a journal takes the offset back to the erase start */
+static void Journal_Invalidate_Range (uint32_t Range_Start , uint32_t Range_End)
+{
+	const BL_Record_t *Record ;
+	BL_Journal_Record_t Journals[BL_JOURNAL_ERASE_MAX] ;
+	uint32_t Seen_Base[BL_JOURNAL_ERASE_MAX] ;
+	uint8_t Seen_Count = 0 ;
+	uint8_t Journal_Count = 0 ;
+	uint8_t Journal_Counter ;
+	uint8_t Already_Seen ;
+	const BL_Journal_Record_t *Journal ;
+
+	/* Latest record of every image , newest first , copied out before any record is written */
+	Record = BL_Record_Previous(BL_RECORD_TYPE_JOURNAL, NULL) ;
+	while ((Record != NULL) && (Seen_Count < BL_JOURNAL_ERASE_MAX))
+	{
+		Journal = &Record->Data.Journal ;
+		Already_Seen = 0 ;
+		for (Journal_Counter = 0 ; Journal_Counter < Seen_Count ; Journal_Counter++)
+		{
+			if (Seen_Base[Journal_Counter] == Journal->Image_Base)
+			{
+				Already_Seen = 1 ;
+				break ;
+			}
+		}
+		if (Already_Seen == 0)
+		{
+			Seen_Base[Seen_Count] = Journal->Image_Base ;
+			Seen_Count++ ;
+			if ((Journal->Committed_Offset != 0) && (Range_Start < (Journal->Image_Base + Journal->Committed_Offset)) &&
+				(Range_End > Journal->Image_Base))
+			{
+				Journals[Journal_Count] = *Journal ;
+				Journals[Journal_Count].Committed_Offset = (Range_Start > Journal->Image_Base) ? (Range_Start - Journal->Image_Base) : 0 ;
+				Journal_Count++ ;
+			}
+		}
+		Record = BL_Record_Previous(BL_RECORD_TYPE_JOURNAL, Record) ;
+	}
+
+	for (Journal_Counter = 0 ; Journal_Counter < Journal_Count ; Journal_Counter++)
+	{
+		BL_Record_Write(BL_RECORD_TYPE_JOURNAL, (uint32_t *)&Journals[Journal_Counter]) ;
+	}
+
+	/* The download in progress restarts from the erase too */
+	if ((BL_Journal_State == JOURNAL_ACTIVE) &&
+		(Range_Start < (BL_Journal_Record.Image_Base + BL_Journal_Record.Committed_Offset)) &&
+		(Range_End > BL_Journal_Record.Image_Base))
+	{
+		BL_Journal_Record.Committed_Offset = (Range_Start > BL_Journal_Record.Image_Base) ? (Range_Start - BL_Journal_Record.Image_Base) : 0 ;
+		if (BL_Journal_Persisted > BL_Journal_Record.Committed_Offset)
+		{
+			BL_Journal_Persisted = BL_Journal_Record.Committed_Offset ;
+		}
+	}
+}
+
+/*
+ * Query (Image Base) , Start (Image Base , Length , Image ID) , Clear (Image Base).
+ * Start resumes a journal of the same image , the reply is always the persisted journal.
+ */
+static void BL_Journal(uint8_t *Host_Buffer)
+{
+	uint32_t Image_Base ;
+	const BL_Record_t *Record ;
+	BL_Journal_Record_t New_Journal ;
+	/* Image Base , Image Length , Image ID , Committed Offset */
+	BL_Journal_Record_t Journal_Report = {0} ;
+
+	Image_Base = *((uint32_t*)(&Host_Buffer[3])) ;
+	Record = BL_Record_Find(BL_RECORD_TYPE_JOURNAL, Image_Base) ;
+
+	if (Host_Buffer[2] == BL_JOURNAL_START)
+	{
+		New_Journal.Image_Base       = Image_Base ;
+		New_Journal.Image_Length     = *((uint32_t*)(&Host_Buffer[7])) ;
+		New_Journal.Image_ID         = *((uint32_t*)(&Host_Buffer[11])) ;
+		New_Journal.Committed_Offset = 0 ;
+
+		if ((Record != NULL) && (Record->Data.Journal.Image_Length == New_Journal.Image_Length) &&
+			(Record->Data.Journal.Image_ID == New_Journal.Image_ID))
+		{
+			/* Same image , resume */
+			New_Journal.Committed_Offset = Record->Data.Journal.Committed_Offset ;
+		}
+		else if (Host_Region_Verification(Image_Base, New_Journal.Image_Length) != ADDRESS_VALID)
+		{
+			New_Journal.Image_Length = 0 ;
+		}
+		else if (BL_Record_Write(BL_RECORD_TYPE_JOURNAL, (uint32_t *)&New_Journal) != RECORD_WRITE_DONE)
+		{
+			New_Journal.Image_Length = 0 ;
+		}
+
+		BL_Journal_State = JOURNAL_IDLE ;
+		if (New_Journal.Image_Length != 0)
+		{
+			BL_Journal_Record = New_Journal ;
+			BL_Journal_Persisted = New_Journal.Committed_Offset ;
+			BL_Journal_State = JOURNAL_ACTIVE ;
+			Journal_Report = New_Journal ;
+		}
+	}
+	else if (Host_Buffer[2] == BL_JOURNAL_CLEAR)
+	{
+		if (Record != NULL)
+		{
+			New_Journal = Record->Data.Journal ;
+			New_Journal.Image_Length = 0 ;
+			New_Journal.Image_ID = 0 ;
+			New_Journal.Committed_Offset = 0 ;
+			BL_Record_Write(BL_RECORD_TYPE_JOURNAL, (uint32_t *)&New_Journal) ;
+		}
+		if (BL_Journal_Record.Image_Base == Image_Base)
+		{
+			BL_Journal_State = JOURNAL_IDLE ;
+		}
+		Journal_Report.Image_Base = Image_Base ;
+	}
+	else if (Record != NULL)
+	{
+		Journal_Report = Record->Data.Journal ;
+	}
+
+	Send_ACK_Reply(sizeof(Journal_Report)) ;
+	Host_Transmit((uint8_t *)&Journal_Report, sizeof(Journal_Report)) ;
+}
+
+/*
+ * Start an image through its vector table. Everything the bootloader enabled is
+ * switched off ( UARTs , CRC , GPIO clocks , SysTick , NVIC lines ) so the image
+ * starts as from a reset and can never take a stale interrupt. The cost in cycles
+ * is left in the shared RAM for the image to read.
+ */
+static void Image_Handoff (uint32_t Vector_Base)
+{
+	uint32_t Start_Cycles ;
+	uint32_t MSP_Value   = ((volatile uint32_t *) Vector_Base)[0] ;
+	pMainApp Reset_Handler_Address = (pMainApp) ((volatile uint32_t *) Vector_Base)[1] ;
+	uint8_t NVIC_Counter ;
+
+	/* Pending log entries go out before their port is torn down */
+	BL_Log_Flush() ;
+
+	Cycle_Counter_Enable() ;
+	Start_Cycles = DWT->CYCCNT ;
+	BL_Shared.Decision_Cycles = Start_Cycles ;
+
+	__disable_irq() ;
+
+	/* Peripherals the early boot stage did not start are still in reset state */
+	if (huart2.gState != HAL_UART_STATE_RESET)
+	{
+		HAL_UART_DeInit(&huart2) ;
+	}
+	if (huart3.gState != HAL_UART_STATE_RESET)
+	{
+		HAL_UART_DeInit(&huart3) ;
+	}
+	if (hcrc.State != HAL_CRC_STATE_RESET)
+	{
+		HAL_CRC_DeInit(&hcrc) ;
+	}
+	__HAL_RCC_GPIOA_CLK_DISABLE() ;
+	__HAL_RCC_GPIOB_CLK_DISABLE() ;
+	__HAL_RCC_GPIOH_CLK_DISABLE() ;
+	__HAL_RCC_DMA1_CLK_DISABLE() ;
+
+#if BL_HANDOFF_KEEP_PLL == 0
+	/* Back to HSI , this restarts SysTick so it is stopped after */
+	HAL_RCC_DeInit() ;
+#endif
+	/* Enabled by HAL_MspInit , the regulator scale set through PWR is kept */
+	__HAL_RCC_SYSCFG_CLK_DISABLE() ;
+	__HAL_RCC_PWR_CLK_DISABLE() ;
+
+	SysTick->CTRL = 0 ;
+	SysTick->LOAD = 0 ;
+	SysTick->VAL = 0 ;
+	SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk ;
+
+	for (NVIC_Counter = 0 ; NVIC_Counter < (sizeof(NVIC->ICER)/sizeof(NVIC->ICER[0])) ; NVIC_Counter++)
+	{
+		NVIC->ICER[NVIC_Counter] = 0xFFFFFFFFU ;
+		NVIC->ICPR[NVIC_Counter] = 0xFFFFFFFFU ;
+	}
+
+	SCB->VTOR = Vector_Base ;
+	__DSB() ;
+	__ISB() ;
+
+	BL_Shared.Handoff_Cycles = DWT->CYCCNT - Start_Cycles ;
+
+	/* Privileged thread mode on MSP , interrupts enabled as after a reset */
+	__set_CONTROL(0) ;
+	__set_MSP(MSP_Value) ;
+	__ISB() ;
+	__enable_irq() ;
+
+	Reset_Handler_Address() ;
+}
+
+/* Image Base , Length , CRC : image loaded in the RAM window , started once it checks out */
+static void BL_RAM_Execute(uint8_t *Host_Buffer)
+{
+	uint32_t Image_Base ;
+	uint32_t Image_Length ;
+	uint32_t Image_CRC ;
+	uint8_t Execute_Status = APP_INVALID ;
+
+	Send_ACK_Reply(1) ;
+	Image_Base   = *((uint32_t*)(&Host_Buffer[2])) ;
+	Image_Length = *((uint32_t*)(&Host_Buffer[6])) ;
+	Image_CRC    = *((uint32_t*)(&Host_Buffer[10])) ;
+
+	if ((Ram_Load_Verification(Image_Base, Image_Length) == ADDRESS_VALID) &&
+		((Image_Base & (BL_VECTOR_TABLE_ALIGN - 1)) == 0) &&
+		(Image_Length >= 8) &&
+		(Vector_Table_Sanity(Image_Base, Image_Length) == APP_VALID) &&
+		(Flash_Image_CRC(Image_Base, Image_Length) == Image_CRC))
+	{
+		Execute_Status = APP_VALID ;
+	}
+
+	/* Blocking transmit returns once the last bit has left */
+	Host_Transmit(&Execute_Status, 1) ;
+
+	if (Execute_Status == APP_VALID)
+	{
+		Image_Handoff(Image_Base) ;
+	}
+}
+
+/* Mode : reset into the application , or reset and stay in the bootloader */
+static void BL_System_Reset(uint8_t *Host_Buffer)
+{
+	uint8_t Reset_Status = BL_SEND_ACK ;
+
+	Send_ACK_Reply(1) ;
+	Host_Transmit(&Reset_Status, 1) ;
+
+	BL_Log_Flush() ;
+	if (Host_Buffer[2] == BL_RESET_TO_BOOTLOADER)
+	{
+		BL_Request_Bootloader() ;
+	}
+	NVIC_SystemReset() ;
+}
+
+/* Clock tree as running : HSE or the HSI fallback , bus clocks and the real host baud rate */
+static void BL_Get_Clock_Info(uint8_t *Host_Buffer)
+{
+	/* SYSCLK Source ( 0 HSI , 1 HSE , 2 PLL ) , PLL Source ( 0 HSI , 1 HSE ) , SYSCLK , HCLK , PCLK1 , PCLK2 , Host Baud */
+	uint32_t Clock_Report[7] ;
+
+	Clock_Report[0] = (RCC->CFGR & RCC_CFGR_SWS) >> RCC_CFGR_SWS_Pos ;
+	Clock_Report[1] = (RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) >> RCC_PLLCFGR_PLLSRC_Pos ;
+	Clock_Report[2] = HAL_RCC_GetSysClockFreq() ;
+	Clock_Report[3] = HAL_RCC_GetHCLKFreq() ;
+	Clock_Report[4] = HAL_RCC_GetPCLK1Freq() ;
+	Clock_Report[5] = HAL_RCC_GetPCLK2Freq() ;
+	/* USART2 and USART3 are on APB1 , oversampling by 16 : BRR holds fck / baud */
+	Clock_Report[6] = Clock_Report[4] / (BL_HOST_COMMUNICATION_UART)->Instance->BRR ;
+
+	Send_ACK_Reply(sizeof(Clock_Report)) ;
+	Host_Transmit((uint8_t *)Clock_Report, sizeof(Clock_Report)) ;
+}
+
+static void BL_Get_Stats(uint8_t *Host_Buffer)
+{
+	uint8_t Command ;
+	uint8_t Stats_Status = STATS_INVALID_COMMAND ;
+	const BL_Command_Stats_t *Stats ;
+	uint8_t Phase_Counter ;
+	/* Count , Errors , Min , Avg , Max , then the average cycles of every phase */
+	uint32_t Stats_Report[BL_STATS_REPORT_WORDS] = {0} ;
+
+	/* Command ID (1) , Clear (1) */
+	Command = Host_Buffer[2] ;
+
+	if ((Command >= BL_STATS_FIRST_CMD) && (Command < (BL_STATS_FIRST_CMD + BL_STATS_COMMANDS)) &&
+		(BL_Command_Table[Command - BL_COMMAND_FIRST].Handler != NULL))
+	{
+		Stats = &BL_Command_Stats[Command - BL_STATS_FIRST_CMD] ;
+
+		Stats_Report[0] = Stats->Count ;
+		Stats_Report[1] = Stats->Errors ;
+		Stats_Report[2] = Stats->Min_Cycles ;
+		Stats_Report[4] = Stats->Max_Cycles ;
+		if (Stats->Count != 0)
+		{
+			Stats_Report[3] = (uint32_t)(Stats->Total_Cycles / Stats->Count) ;
+			for (Phase_Counter = 0 ; Phase_Counter < BL_STATS_PHASES ; Phase_Counter++)
+			{
+				Stats_Report[5 + Phase_Counter] = (uint32_t)(Stats->Phase_Cycles[Phase_Counter] / Stats->Count) ;
+			}
+		}
+
+		Send_ACK_Reply(sizeof(Stats_Report)) ;
+		Host_Transmit((uint8_t *)Stats_Report, sizeof(Stats_Report)) ;
+
+		if (Host_Buffer[3] == BL_STATS_CLEAR)
+		{
+			memset(BL_Command_Stats, 0, sizeof(BL_Command_Stats)) ;
+			BL_Stats_Skip = 1 ;
+		}
+	}
+	else
+	{
+		Send_ACK_Reply(1) ;
+		Host_Transmit(&Stats_Status, 1) ;
+	}
+}
+
+/*
+ * Raw link test , the HAL is bypassed so the numbers are those of the wire.
+ * Bytes are taken by polling the data register and the error flags of every
+ * byte are counted. Echo sends each byte back before taking the next one.
+ * Time is split between waiting for a byte and handling it , from the first
+ * byte to the last one.
+ */
+static void BL_Link_Bench(uint8_t *Host_Buffer)
+{
+	USART_TypeDef *Link = (BL_HOST_COMMUNICATION_UART)->Instance ;
+	uint8_t  Bench_Mode ;
+	uint32_t Bench_Length ;
+	uint32_t Status_Register ;
+	uint8_t  Link_Byte ;
+	uint32_t Last_Byte_Tick ;
+	uint32_t Last_Byte_Cycles = 0 ;
+	uint32_t Wait_Start ;
+	uint32_t Process_Start ;
+	/* CYCCNT wraps every 25 s at 168 MHz , a slow stream lasts longer : add up short deltas */
+	uint64_t Span_Cycles = 0 ;
+	uint64_t Wait_Cycles = 0 ;
+	uint64_t Process_Cycles = 0 ;
+	/* Bytes , Bytes/s , Cycles , Wait Cycles , Process Cycles , ORE , FE , NE , Baud , Frame Bits */
+	/* Cycle words saturate at 0xFFFFFFFF , Bytes/s comes from the full count */
+	uint32_t Bench_Report[10] = {0} ;
+
+	/* Mode (1) , Length (4) */
+	Bench_Mode = Host_Buffer[2] ;
+	Bench_Length = *((uint32_t*)(&Host_Buffer[3])) ;
+
+	/* The report follows the stream */
+	Send_ACK_Reply(sizeof(Bench_Report)) ;
+
+	/* Drop whatever is left in the receiver before the stream starts */
+	(void)Link->SR ;
+	(void)Link->DR ;
+
+	Last_Byte_Tick = HAL_GetTick() ;
+	Wait_Start = DWT->CYCCNT ;
+	while ((Bench_Report[0] < Bench_Length) && ((HAL_GetTick() - Last_Byte_Tick) < BL_LINK_BENCH_IDLE_TIMEOUT))
+	{
+		Status_Register = Link->SR ;
+		if ((Status_Register & USART_SR_RXNE) != 0)
+		{
+			Process_Start = DWT->CYCCNT ;
+			/* Reading DR after SR clears the error flags of this byte */
+			Link_Byte = (uint8_t)Link->DR ;
+			if (Bench_Report[0] != 0)
+			{
+				Span_Cycles += Process_Start - Last_Byte_Cycles ;
+				Wait_Cycles += Process_Start - Wait_Start ;
+			}
+			Last_Byte_Cycles = Process_Start ;
+			Bench_Report[0]++ ;
+			Bench_Report[5] += ((Status_Register & USART_SR_ORE) != 0) ? 1 : 0 ;
+			Bench_Report[6] += ((Status_Register & USART_SR_FE) != 0) ? 1 : 0 ;
+			Bench_Report[7] += ((Status_Register & USART_SR_NE) != 0) ? 1 : 0 ;
+
+			if (Bench_Mode == BL_LINK_BENCH_ECHO)
+			{
+				while ((Link->SR & USART_SR_TXE) == 0)
+				{
+				}
+				Link->DR = Link_Byte ;
+			}
+
+			Last_Byte_Tick = HAL_GetTick() ;
+			Wait_Start = DWT->CYCCNT ;
+			Process_Cycles += Wait_Start - Process_Start ;
+		}
+	}
+
+	/* Span from the first to the last received byte */
+	Bench_Report[2] = (Span_Cycles > 0xFFFFFFFFU) ? 0xFFFFFFFFU : (uint32_t)Span_Cycles ;
+	Bench_Report[3] = (Wait_Cycles > 0xFFFFFFFFU) ? 0xFFFFFFFFU : (uint32_t)Wait_Cycles ;
+	Bench_Report[4] = (Process_Cycles > 0xFFFFFFFFU) ? 0xFFFFFFFFU : (uint32_t)Process_Cycles ;
+	if (Span_Cycles != 0)
+	{
+		/* A single byte has no span , the rate needs at least two */
+		Bench_Report[1] = (uint32_t)(((uint64_t)(Bench_Report[0] - 1) * SystemCoreClock) / Span_Cycles) ;
+	}
+	/* USART2 and USART3 are on APB1 , oversampling by 16 : BRR holds fck / baud */
+	Bench_Report[8] = HAL_RCC_GetPCLK1Freq() / Link->BRR ;
+	/* Start bit , 8 or 9 data bits ( parity included ) , 1 or 2 stop bits */
+	Bench_Report[9] = 1 + (((Link->CR1 & USART_CR1_M) != 0) ? 9 : 8) + (((Link->CR2 & USART_CR2_STOP) == USART_CR2_STOP_1) ? 2 : 1) ;
+
+	/* Echo bytes must be out before the report */
+	while ((Link->SR & USART_SR_TC) == 0)
+	{
+	}
+	Host_Transmit((uint8_t *)Bench_Report, sizeof(Bench_Report)) ;
+}
+
+static void BL_Get_Mem_Usage(uint8_t *Host_Buffer)
+{
+	const uint32_t *Stack_Word = &_sstack ;
+	/* In bytes : Stack Size , Stack Peak , Stack Now , .data , .bss , Heap , RAM Headroom , CCMRAM Used */
+	uint32_t Memory_Report[8] ;
+
+	/* Deepest point ever reached is the first word no longer painted */
+	while ((Stack_Word < &_estack) && (*Stack_Word == BL_STACK_PAINT))
+	{
+		Stack_Word++ ;
+	}
+
+	Memory_Report[0] = (uint32_t)&_estack - (uint32_t)&_sstack ;
+	Memory_Report[1] = (uint32_t)&_estack - (uint32_t)Stack_Word ;
+	Memory_Report[2] = (uint32_t)&_estack - __get_MSP() ;
+	Memory_Report[3] = (uint32_t)&_edata - (uint32_t)&_sdata ;
+	Memory_Report[4] = (uint32_t)&_ebss - (uint32_t)&_sbss ;
+	Memory_Report[5] = (uint32_t)&_Min_Heap_Size ;
+	/* Bootloader data and heap must end below the RAM load window */
+	Memory_Report[6] = BL_RAM_LOAD_BASE - ((uint32_t)&_end + (uint32_t)&_Min_Heap_Size) ;
+	Memory_Report[7] = (uint32_t)&_eccmbss - (uint32_t)&_sccmram ;
+
+	Send_ACK_Reply(sizeof(Memory_Report)) ;
+	Host_Transmit((uint8_t *)Memory_Report, sizeof(Memory_Report)) ;
+}
+
+static void Jump_To_User_App (void)
+{
+	uint32_t Vector_Base ;
+
+	/* Never jump into an image that was not validated */
+	if (BL_App_Validity_Check() != APP_VALID)
+	{
+		return ;
+	}
+
+	Vector_Base = Image_Vector_Base(BL_Boot_Image_Base) ;
+
+	Image_Handoff(Vector_Base) ;
+}
+
+/* Boot pin sampled with the internal pull down , port left as the reset state found it */
+static uint8_t Boot_Pin_Requested (void)
+{
+	uint32_t PUPD_Hold ;
+	uint32_t Pin_State ;
+	volatile uint32_t Settle ;
+
+	__HAL_RCC_GPIOA_CLK_ENABLE() ;
+	PUPD_Hold = BL_BOOT_PIN_PORT->PUPDR ;
+	BL_BOOT_PIN_PORT->PUPDR = (PUPD_Hold & ~BL_BOOT_PIN_PUPD_MASK) | BL_BOOT_PIN_PULL_DOWN ;
+	for (Settle = 0 ; Settle < BL_BOOT_PIN_SETTLE ; Settle++)
+	{
+	}
+	Pin_State = BL_BOOT_PIN_PORT->IDR & BL_BOOT_PIN ;
+	BL_BOOT_PIN_PORT->PUPDR = PUPD_Hold ;
+	__HAL_RCC_GPIOA_CLK_DISABLE() ;
+
+	return (Pin_State != 0) ? 1 : 0 ;
+}
+
+/*
+ * One shot boot request , honoured only after a software reset so RAM left random
+ * by a power up can never hold it by chance. The reset flags are kept in the shared
+ * RAM for the application and then cleared.
+ */
+static uint8_t Boot_Request_Taken (void)
+{
+	uint8_t Boot_Request = 0 ;
+	uint32_t Reset_Cause = RCC->CSR ;
+
+	BL_Shared.Reset_Cause = Reset_Cause ;
+	RCC->CSR |= RCC_CSR_RMVF ;
+
+#if BL_BOOT_REQUEST_SOURCE == BL_BOOT_REQUEST_BKP
+	__HAL_RCC_PWR_CLK_ENABLE() ;
+	if (RTC->BKP0R == BL_BOOT_REQUEST_MAGIC)
+	{
+		PWR->CR |= PWR_CR_DBP ;
+		RTC->BKP0R = 0 ;
+		PWR->CR &= ~PWR_CR_DBP ;
+		Boot_Request = 1 ;
+	}
+	__HAL_RCC_PWR_CLK_DISABLE() ;
+#else
+	if (BL_Shared.Boot_Request == BL_BOOT_REQUEST_MAGIC)
+	{
+		BL_Shared.Boot_Request = 0 ;
+		Boot_Request = 1 ;
+	}
+#endif
+
+	if ((Reset_Cause & RCC_CSR_SFTRSTF) == 0)
+	{
+		Boot_Request = 0 ;
+	}
+
+	return Boot_Request ;
+}
+
+/*
+ * First thing in main , before HAL_Init and the PLL. Runs on the reset HSI clock
+ * with only the CRC unit enabled ( records are CRC checked ). Returns only when
+ * the bootloader has to stay : boot pin , boot request or no valid image.
+ */
+void BL_Early_Boot (void)
+{
+	/* Cycles from here are reported as the boot decision cost */
+	Cycle_Counter_Enable() ;
+	DWT->CYCCNT = 0 ;
+
+	if ((Boot_Request_Taken() == 0) && (Boot_Pin_Requested() == 0))
+	{
+		MX_CRC_Init() ;
+		Jump_To_User_App() ;
+	}
+}
+
+BL_Status BL_UART_Fetch_Host_Commands (void)
+{
+	BL_Status Status = BL_NACK ;
+	/* UART RX return */
+	HAL_StatusTypeDef HAL_Status = HAL_ERROR ;
 	uint8_t Data_Length = 0 ;
+	uint16_t Frame_Length ;
+	uint8_t Command ;
+	const BL_Command_t *Entry ;
+	uint32_t Start_Cycles ;
+	/* Every byte of the frame is written once by the receive , nothing is cleared */
+	uint8_t *Host_Buffer = BL_Host_Frame.Data ;
 
-	/* Array Elements = 0 */
-	memset(BL_Host_Buffer,0,BL_HOST_BUFFER_RX_LENGTH) ;
+	/* Idle until the host speaks , let the log drain meanwhile */
+	BL_Log_Process() ;
 
 	/* Receiving the  Command Length */
-	HAL_Status = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, BL_Host_Buffer, 1, HAL_MAX_DELAY) ;
+	HAL_Status = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, Host_Buffer, 1, HAL_MAX_DELAY) ;
 
 	if (HAL_Status != HAL_OK)
 	{
@@ -606,9 +2478,14 @@ BL_Status BL_UART_Fetch_Host_Commands (void)
 	else
 	{
 
-	Data_Length = BL_Host_Buffer[0] ;
+	/* The command is timed from its length byte , the wait before it is idle time */
+	Start_Cycles = DWT->CYCCNT ;
+	Stats_Begin() ;
+
+	Data_Length = Host_Buffer[0] ;
 	/* Receive the rest of Record */
-	HAL_Status = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, &(BL_Host_Buffer[1]), Data_Length, HAL_MAX_DELAY) ;
+	HAL_Status = HAL_UART_Receive(BL_HOST_COMMUNICATION_UART, &(Host_Buffer[1]), Data_Length, HAL_MAX_DELAY) ;
+	BL_Stats_Phase[BL_STATS_PHASE_RX] = DWT->CYCCNT - Start_Cycles ;
 
 			if (HAL_Status != HAL_OK)
 			{
@@ -618,71 +2495,39 @@ BL_Status BL_UART_Fetch_Host_Commands (void)
 			else
 			{
 
-				switch (BL_Host_Buffer[1])
+				/* One lookup , then the length and CRC checks every command shares */
+				Command = Host_Buffer[1] ;
+				Entry = NULL ;
+				if ((Command >= BL_COMMAND_FIRST) && (Command <= BL_COMMAND_LAST))
 				{
-				case CBL_GET_VER_CMD  		 	 :
-					Status = BL_ACK ;
-					Print_Message("CBL_GET_VER_CMD \r\n") ;
-					BL_Get_Version(BL_Host_Buffer) ;
-					break ;
-				case CBL_GET_HELP_CMD 		 	 :
-					Status = BL_ACK ;
-					Print_Message("CBL_GET_HELP_CMD \r\n") ;
-					BL_Get_Help(BL_Host_Buffer) ;
-					break ;
-				case CBL_GET_CID_CMD  		 	 :
-					Status = BL_ACK ;
-					Print_Message("CBL_GET_CID_CMD \r\n") ;
-					BL_Get_Chip_Identification_Number(BL_Host_Buffer);
-					break ;
-				case CBL_GET_RDP_STATUS_CMD  	 :
-					Status = BL_ACK ;
-					Print_Message("CBL_GET_RDP_STATUS_CMD \r\n") ;
-					BL_Read_Protection_Level(BL_Host_Buffer) ;
-					break ;
-				case CBL_GO_TO_ADDR_CMD  		 :
-					Status = BL_ACK ;
-					Print_Message("CBL_GO_TO_ADDR_CMD \r\n") ;
-					BL_Jump_To_Address(BL_Host_Buffer) ;
-					break ;
-				case CBL_FLASH_ERASE_CMD  		 :
-					Status = BL_ACK ;
-					Print_Message("CBL_FLASH_ERASE_CMD \r\n") ;
-					BL_Erase_Flash(BL_Host_Buffer) ;
-					break ;
-				case CBL_MEM_WRITE_CMD  		 :
-					Status = BL_ACK ;
-					Print_Message("CBL_MEM_WRITE_CMD \r\n") ;
-					BL_Memory_Write(BL_Host_Buffer) ;
-					break ;
-				case CBL_EN_R_W_PROTECT_CMD  	 :
-					Status = BL_ACK ;
-					Print_Message("CBL_EN_R_W_PROTECT_CMD \r\n") ;
-					break ;
-				case CBL_MEM_READ_CMD  			 :
-					Status = BL_ACK ;
-					Print_Message("CBL_MEM_READ_CMD \r\n") ;
-					break ;
-				case CBL_READ_SECTOR_STATUS_CMD  :
-					Status = BL_ACK ;
-					Print_Message("CBL_READ_SECTOR_STATUS_CMD \r\n") ;
-					break ;
-				case CBL_OTP_READ_CMD  			 :
-					Status = BL_ACK ;
-					Print_Message("CBL_OTP_READ_CMD \r\n") ;
-					break ;
-				case CBL_CHANGE_ROP_Level_CMD  	 :
-					Status = BL_ACK ;
-					Print_Message("Change Read Protection Level \r\n") ;
-					BL_Change_Read_Protection(BL_Host_Buffer) ;
-					break ;
-				default :
-					Print_Message("Invalid Command \r\n") ;
-					Status = BL_NACK ;
-					break ;
-
+					Entry = &BL_Command_Table[Command - BL_COMMAND_FIRST] ;
+				}
 
+				if ((Entry == NULL) || (Entry->Handler == NULL))
+				{
+					BL_LOG_ERROR("Invalid Command 0x%X", Command) ;
+					Status = BL_NACK ;
 				}
+				else
+				{
+					Status = BL_ACK ;
+					BL_LOG_DEBUG("Command 0x%X", Command) ;
+					Frame_Length = Data_Length + 1 ;
+					if ((Frame_Length >= Entry->Min_Length) &&
+						((Entry->Mode == BL_CMD_NO_MODE) || (Host_Buffer[2] != Entry->Mode) || (Frame_Length >= Entry->Mode_Min_Length)) &&
+						(CRC_Verify(Host_Buffer, Frame_Length - CRC_TYPE_SIZE_BYTE,
+									__UNALIGNED_UINT32_READ(&Host_Buffer[Frame_Length - CRC_TYPE_SIZE_BYTE])) == CRC_OK))
+					{
+						Entry->Handler(Host_Buffer) ;
+					}
+					else
+					{
+						Send_NACK() ;
+					}
+				}
+
+				/* Saved before dispatch , a handler may reuse its frame */
+				Stats_End(Command, DWT->CYCCNT - Start_Cycles) ;
 			}
 
 	}
@@ -19,6 +19,7 @@
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
 #include "crc.h"
+#include "dma.h"
 #include "usart.h"
 #include "gpio.h"
 
@@ -54,7 +55,7 @@
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 /* USER CODE BEGIN PFP */
-
+static void SystemClock_Fallback_Config(void) ;
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
@@ -69,6 +70,8 @@ void SystemClock_Config(void);
 int main(void)
 {
   /* USER CODE BEGIN 1 */
+  /* Straight to the application unless an update is requested */
+  BL_Early_Boot() ;
 
   /* USER CODE END 1 */
 
@@ -81,19 +84,20 @@ int main(void)
 
   /* USER CODE END Init */
 
-  /* Configure the system clock */
-  SystemClock_Config();
-
   /* USER CODE BEGIN SysInit */
+  /* SystemClock_Config call is not generated ( BL.ioc ) , it is made from here */
+  SystemClock_Fallback_Config() ;
 
   /* USER CODE END SysInit */
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_CRC_Init();
   MX_USART2_UART_Init();
   MX_USART3_UART_Init();
   /* USER CODE BEGIN 2 */
+  BL_Log_Init(BL_DEBUG_UART) ;
 
   /* USER CODE END 2 */
 
@@ -104,6 +108,7 @@ int main(void)
     /* USER CODE END WHILE */
 
     /* USER CODE BEGIN 3 */
+    BL_UART_Fetch_Host_Commands() ;
   }
   /* USER CODE END 3 */
 }
@@ -124,16 +129,16 @@ void SystemClock_Config(void)
 
   /** Initializes the RCC Oscillators according to the specified parameters
   * in the RCC_OscInitTypeDef structure.
+  * 8 MHz crystal : 8 / 8 * 336 / 2 = 168 MHz , 48 MHz on PLLQ
   */
-  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSI;
-  RCC_OscInitStruct.HSIState = RCC_HSI_ON;
-  RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT;
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE;
+  RCC_OscInitStruct.HSEState = RCC_HSE_ON;
   RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON;
-  RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI;
+  RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSE;
   RCC_OscInitStruct.PLL.PLLM = 8;
-  RCC_OscInitStruct.PLL.PLLN = 168;
+  RCC_OscInitStruct.PLL.PLLN = 336;
   RCC_OscInitStruct.PLL.PLLP = RCC_PLLP_DIV2;
-  RCC_OscInitStruct.PLL.PLLQ = 4;
+  RCC_OscInitStruct.PLL.PLLQ = 7;
   if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
   {
     Error_Handler();
@@ -155,7 +160,58 @@ void SystemClock_Config(void)
 }
 
 /* USER CODE BEGIN 4 */
+/**
+  * @brief Starts the crystal first , SystemClock_Config runs only when it is ready.
+  *        When it does not start within HSE_STARTUP_TIMEOUT the same 168 MHz is
+  *        made from HSI ( about 1 % ) instead of stopping in Error_Handler.
+  * @retval None
+  */
+static void SystemClock_Fallback_Config(void)
+{
+  RCC_OscInitTypeDef RCC_OscInitStruct = {0};
+  RCC_ClkInitTypeDef RCC_ClkInitStruct = {0};
 
+  RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE ;
+  RCC_OscInitStruct.HSEState = RCC_HSE_ON ;
+  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE ;
+  if (HAL_RCC_OscConfig(&RCC_OscInitStruct) == HAL_OK)
+  {
+    SystemClock_Config() ;
+  }
+  else
+  {
+    __HAL_RCC_PWR_CLK_ENABLE() ;
+    __HAL_PWR_VOLTAGESCALING_CONFIG(PWR_REGULATOR_VOLTAGE_SCALE1) ;
+
+    /* 16 MHz HSI : 16 / 16 * 336 / 2 = 168 MHz , 48 MHz on PLLQ */
+    RCC_OscInitStruct.OscillatorType = RCC_OSCILLATORTYPE_HSE|RCC_OSCILLATORTYPE_HSI ;
+    RCC_OscInitStruct.HSEState = RCC_HSE_OFF ;
+    RCC_OscInitStruct.HSIState = RCC_HSI_ON ;
+    RCC_OscInitStruct.HSICalibrationValue = RCC_HSICALIBRATION_DEFAULT ;
+    RCC_OscInitStruct.PLL.PLLState = RCC_PLL_ON ;
+    RCC_OscInitStruct.PLL.PLLSource = RCC_PLLSOURCE_HSI ;
+    RCC_OscInitStruct.PLL.PLLM = 16 ;
+    RCC_OscInitStruct.PLL.PLLN = 336 ;
+    RCC_OscInitStruct.PLL.PLLP = RCC_PLLP_DIV2 ;
+    RCC_OscInitStruct.PLL.PLLQ = 7 ;
+    if (HAL_RCC_OscConfig(&RCC_OscInitStruct) != HAL_OK)
+    {
+      Error_Handler() ;
+    }
+
+    /* Same bus dividers as SystemClock_Config */
+    RCC_ClkInitStruct.ClockType = RCC_CLOCKTYPE_HCLK|RCC_CLOCKTYPE_SYSCLK
+                                |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2 ;
+    RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK ;
+    RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1 ;
+    RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV4 ;
+    RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV2 ;
+    if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_5) != HAL_OK)
+    {
+      Error_Handler() ;
+    }
+  }
+}
 /* USER CODE END 4 */
 
 /**
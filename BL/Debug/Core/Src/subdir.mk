@@ -5,8 +5,15 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../Core/Src/BL_AES.c \
+../Core/Src/BL_Delta.c \
+../Core/Src/BL_Log.c \
+../Core/Src/BL_LZ.c \
+../Core/Src/BL_Record.c \
+../Core/Src/BL_SHA256.c \
 ../Core/Src/Bootloader.c \
 ../Core/Src/crc.c \
+../Core/Src/dma.c \
 ../Core/Src/gpio.c \
 ../Core/Src/main.c \
 ../Core/Src/stm32f4xx_hal_msp.c \
@@ -17,8 +24,15 @@ C_SRCS += \
 ../Core/Src/usart.c 
 
 OBJS += \
+./Core/Src/BL_AES.o \
+./Core/Src/BL_Delta.o \
+./Core/Src/BL_Log.o \
+./Core/Src/BL_LZ.o \
+./Core/Src/BL_Record.o \
+./Core/Src/BL_SHA256.o \
 ./Core/Src/Bootloader.o \
 ./Core/Src/crc.o \
+./Core/Src/dma.o \
 ./Core/Src/gpio.o \
 ./Core/Src/main.o \
 ./Core/Src/stm32f4xx_hal_msp.o \
@@ -29,8 +43,15 @@ OBJS += \
 ./Core/Src/usart.o 
 
 C_DEPS += \
+./Core/Src/BL_AES.d \
+./Core/Src/BL_Delta.d \
+./Core/Src/BL_Log.d \
+./Core/Src/BL_LZ.d \
+./Core/Src/BL_Record.d \
+./Core/Src/BL_SHA256.d \
 ./Core/Src/Bootloader.d \
 ./Core/Src/crc.d \
+./Core/Src/dma.d \
 ./Core/Src/gpio.d \
 ./Core/Src/main.d \
 ./Core/Src/stm32f4xx_hal_msp.d \
@@ -48,7 +69,7 @@ Core/Src/%.o Core/Src/%.su Core/Src/%.cyclo: ../Core/Src/%.c Core/Src/subdir.mk
 clean: clean-Core-2f-Src
 
 clean-Core-2f-Src:
-	-$(RM) ./Core/Src/Bootloader.cyclo ./Core/Src/Bootloader.d ./Core/Src/Bootloader.o ./Core/Src/Bootloader.su ./Core/Src/crc.cyclo ./Core/Src/crc.d ./Core/Src/crc.o ./Core/Src/crc.su ./Core/Src/gpio.cyclo ./Core/Src/gpio.d ./Core/Src/gpio.o ./Core/Src/gpio.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/stm32f4xx_hal_msp.cyclo ./Core/Src/stm32f4xx_hal_msp.d ./Core/Src/stm32f4xx_hal_msp.o ./Core/Src/stm32f4xx_hal_msp.su ./Core/Src/stm32f4xx_it.cyclo ./Core/Src/stm32f4xx_it.d ./Core/Src/stm32f4xx_it.o ./Core/Src/stm32f4xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f4xx.cyclo ./Core/Src/system_stm32f4xx.d ./Core/Src/system_stm32f4xx.o ./Core/Src/system_stm32f4xx.su ./Core/Src/usart.cyclo ./Core/Src/usart.d ./Core/Src/usart.o ./Core/Src/usart.su
+	-$(RM) ./Core/Src/BL_AES.cyclo ./Core/Src/BL_AES.d ./Core/Src/BL_AES.o ./Core/Src/BL_AES.su ./Core/Src/BL_Delta.cyclo ./Core/Src/BL_Delta.d ./Core/Src/BL_Delta.o ./Core/Src/BL_Delta.su ./Core/Src/BL_Log.cyclo ./Core/Src/BL_Log.d ./Core/Src/BL_Log.o ./Core/Src/BL_Log.su ./Core/Src/BL_LZ.cyclo ./Core/Src/BL_LZ.d ./Core/Src/BL_LZ.o ./Core/Src/BL_LZ.su ./Core/Src/BL_Record.cyclo ./Core/Src/BL_Record.d ./Core/Src/BL_Record.o ./Core/Src/BL_Record.su ./Core/Src/BL_SHA256.cyclo ./Core/Src/BL_SHA256.d ./Core/Src/BL_SHA256.o ./Core/Src/BL_SHA256.su ./Core/Src/Bootloader.cyclo ./Core/Src/Bootloader.d ./Core/Src/Bootloader.o ./Core/Src/Bootloader.su ./Core/Src/crc.cyclo ./Core/Src/crc.d ./Core/Src/crc.o ./Core/Src/crc.su ./Core/Src/dma.cyclo ./Core/Src/dma.d ./Core/Src/dma.o ./Core/Src/dma.su ./Core/Src/gpio.cyclo ./Core/Src/gpio.d ./Core/Src/gpio.o ./Core/Src/gpio.su ./Core/Src/main.cyclo ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/stm32f4xx_hal_msp.cyclo ./Core/Src/stm32f4xx_hal_msp.d ./Core/Src/stm32f4xx_hal_msp.o ./Core/Src/stm32f4xx_hal_msp.su ./Core/Src/stm32f4xx_it.cyclo ./Core/Src/stm32f4xx_it.d ./Core/Src/stm32f4xx_it.o ./Core/Src/stm32f4xx_it.su ./Core/Src/syscalls.cyclo ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.cyclo ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f4xx.cyclo ./Core/Src/system_stm32f4xx.d ./Core/Src/system_stm32f4xx.o ./Core/Src/system_stm32f4xx.su ./Core/Src/usart.cyclo ./Core/Src/usart.d ./Core/Src/usart.o ./Core/Src/usart.su
 
 .PHONY: clean-Core-2f-Src
 
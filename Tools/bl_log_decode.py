@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""
+Decode the bootloader debug log.
+
+The target sends every log call as [Length][Format ID][Arguments], the ID being
+the address of the format string in the .bl_log_fmt section of the ELF and the
+arguments 32 bit little endian words. This rebuilds the text from the ELF.
+
+    bl_log_decode.py BL/Debug/BL.elf /dev/ttyUSB1          (live, 115200)
+    bl_log_decode.py BL/Debug/BL.elf capture.bin           (raw capture file)
+"""
+
+import re
+import struct
+import sys
+
+FORMAT_SECTION = ".bl_log_fmt"
+BAUD_RATE = 115200
+
+
+def load_formats(elf_path):
+    """Map every format string address of .bl_log_fmt to its text."""
+    with open(elf_path, "rb") as elf_file:
+        elf = elf_file.read()
+
+    if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+        sys.exit("%s is not a 32 bit little endian ELF" % elf_path)
+
+    (sh_offset,) = struct.unpack_from("<I", elf, 0x20)
+    sh_entsize, sh_num, sh_strndx = struct.unpack_from("<HHH", elf, 0x2E)
+
+    sections = [struct.unpack_from("<IIIIIIIIII", elf, sh_offset + index * sh_entsize)
+                for index in range(sh_num)]
+    names_offset = sections[sh_strndx][4]
+
+    for name, _, _, address, offset, size, _, _, _, _ in sections:
+        end = elf.index(b"\0", names_offset + name)
+        if elf[names_offset + name:end].decode() == FORMAT_SECTION:
+            data = elf[offset:offset + size]
+            break
+    else:
+        sys.exit("%s has no %s section" % (elf_path, FORMAT_SECTION))
+
+    formats = {}
+    start = 0
+    while start < len(data):
+        end = data.index(b"\0", start)
+        if end > start:
+            formats[address + start] = data[start:end].decode(errors="replace")
+        start = end + 1
+        # Every string is its own object, padding between them is zero filled
+        while start < len(data) and data[start] == 0:
+            start += 1
+    return formats
+
+
+def render(text, arguments):
+    """Apply C style conversions to 32 bit arguments."""
+    text = re.sub(r"%([-0 #+]*\d*)(?:hh|h|ll|l|z)?([diuxXc])", r"%\1\2", text)
+    text = text.replace("%u", "%d")
+    try:
+        return text % tuple(arguments)
+    except (TypeError, ValueError):
+        return "%s %s" % (text, " ".join("0x%08X" % word for word in arguments))
+
+
+def decode(stream, formats):
+    while True:
+        header = stream.read(1)
+        if not header:
+            return
+        length = header[0]
+        entry = b""
+        while len(entry) < length:
+            chunk = stream.read(length - len(entry))
+            if not chunk:
+                return
+            entry += chunk
+        if length < 4 or length % 4 != 0:
+            print("<bad entry length %d>" % length)
+            continue
+        words = struct.unpack("<%dI" % (length // 4), entry)
+        text = formats.get(words[0])
+        if text is None:
+            print("<unknown ID 0x%08X>" % words[0])
+        else:
+            print(render(text, words[1:]))
+        sys.stdout.flush()
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    formats = load_formats(sys.argv[1])
+    source = sys.argv[2]
+    if source.startswith("/dev/") or source.upper().startswith("COM"):
+        import serial
+        stream = serial.Serial(source, BAUD_RATE)
+    else:
+        stream = open(source, "rb")
+    try:
+        decode(stream, formats)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()